@@ -12,12 +12,24 @@
 * 1. For each trailhead DFS for all peaks.
 * 2. If peak reached add trailhead to peaks set.
 * 3. Calculate trailhead scores via peak sets.
+*
+* Alternatively process the map layer by layer from height 9 down to 0:
+* every cell sums the path counts (rating) and merges the reachable peak sets (score)
+* of its neighbors one height above.
 */
 
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
 #include <fstream>
 #include <iostream>
+#include <random>
 #include <stdexcept>
 #include <string>
+#include <thread>
 #include <vector>
 #include <unordered_set>
 #include <unordered_map>
@@ -57,8 +69,15 @@ char intToChar(int i)
   return static_cast<int>('0' + i);
 }
 
+// Heights are stored row by row in one flat grid with a one cell border on every side.
+// The border holds a sentinel height that is never one above a real height, so
+// neighbor lookups via fixed index offsets need no bounds checks.
 class Map {
-  std::vector<std::vector<int>> data{};
+  static constexpr uint8_t BORDER_HEIGHT = 0xFF;
+
+  std::vector<uint8_t> heights{};
+  size_t sizeX = 0;
+  size_t sizeY = 0;
   std::vector<Position> trailHeads{};
   std::vector<Position> peaks{};
 public:
@@ -72,132 +91,196 @@ public:
       throw std::runtime_error{"Unable to open file: " + filePathTerminated};
     }
 
+    std::vector<std::string> lines{};
     std::string currentLine{};
-
-    Position currentPosition{
-      .x = 0,
-      .y = 0
-    };
     while (std::getline(file, currentLine))
     {
-      currentPosition.x = 0;
-      std::vector<int> line{};
+      lines.push_back(currentLine);
+    }
+
+    parse(lines);
+  }
+
+  Map(const std::vector<std::string>& lines)
+  {
+    parse(lines);
+  }
+
+  void parse(const std::vector<std::string>& lines)
+  {
+    sizeX = lines.empty() ? 0 : lines.front().size();
+    sizeY = lines.size();
+    heights.assign((sizeX + 2) * (sizeY + 2), BORDER_HEIGHT);
 
-      for (const char c : currentLine)
+    for (size_t y = 0; y < sizeY; ++y)
+    {
+      for (size_t x = 0; x < sizeX; ++x)
       {
-        int height = charToInt(c);
-        line.push_back(height);
+        int height = charToInt(lines[y][x]);
+        heights[getIndex({x, y})] = static_cast<uint8_t>(height);
 
         if (height == 0)
         {
-          trailHeads.push_back(currentPosition);
+          trailHeads.push_back({x, y});
         }
         else if (height == 9)
         {
-          peaks.push_back(currentPosition);
+          peaks.push_back({x, y});
         }
-
-        ++currentPosition.x;
       }
-
-      data.push_back(line);
-      ++currentPosition.y;
     }
   }
 
-  std::vector<Position> getTrailheads()
+  std::vector<Position> getTrailheads() const
   {
     return trailHeads;
   }
 
-  std::vector<Position> getPeaks()
+  std::vector<Position> getPeaks() const
   {
     return peaks;
   }
 
   int get(const Position& pos)
   {
-    return data[pos.y][pos.x];
+    return heights[getIndex(pos)];
   }
 
   void set(const Position& pos, const int value)
   {
-    data[pos.y][pos.x] = value;
+    heights[getIndex(pos)] = static_cast<uint8_t>(value);
   }
 
   int getSizeX()
   {
-    return data.front().size();
+    return sizeX;
   }
 
   int getSizeY()
   {
-    return data.size();
+    return sizeY;
   }
 
   bool contains(const Position& pos)
   {
-    return ((pos.x >= 0)
-      && (pos.y >= 0)
-      && (pos.x < getSizeX())
-      && (pos.y < getSizeY()));
+    return ((pos.x < sizeX) && (pos.y < sizeY));
+  }
+
+  // Index into the padded grid.
+  size_t getIndex(const Position& pos) const
+  {
+    return (pos.y + 1) * (sizeX + 2) + (pos.x + 1);
+  }
+
+  Position getPosition(size_t index) const
+  {
+    return {.x = index % (sizeX + 2) - 1, .y = index / (sizeX + 2) - 1};
+  }
+
+  size_t getPaddedSize() const
+  {
+    return heights.size();
+  }
+
+  const uint8_t* getHeights() const
+  {
+    return heights.data();
+  }
+
+  std::array<ptrdiff_t, 4> getNeighborOffsets() const
+  {
+    ptrdiff_t stride = static_cast<ptrdiff_t>(sizeX + 2);
+    return {stride, -stride, -1, 1};
   }
 
   void print()
   {
-    for (const auto& line : data)
+    for (size_t y = 0; y < sizeY; ++y)
     {
-      for (const auto& height : line)
+      for (size_t x = 0; x < sizeX; ++x)
       {
-        std::cout << height;
+        std::cout << get({x, y});
       }
-        std::cout << std::endl;
+      std::cout << std::endl;
     }
-
   }
 };
 
 // Part1 using ReachablePeaks = std::unordered_map<Position, std::unordered_set<Position, Position::HashFunction>, Position::HashFunction>;
 using ReachablePeaks = std::unordered_map<Position, std::vector<Position>, Position::HashFunction>;
 
-ReachablePeaks calculateReachablePeaks(Map& map)
+void collectReachablePeaks(const Map& map, const Position* firstTrailHead, const Position* lastTrailHead, ReachablePeaks& reachablePeaks)
 {
-  ReachablePeaks reachablePeaks{};
-  std::vector<Position> trailHeads = map.getTrailheads();
+  const uint8_t* heights = map.getHeights();
+  const std::array<ptrdiff_t, 4> neighborOffsets = map.getNeighborOffsets();
 
-  for (const auto& trailHead : trailHeads)
+  // reused for every trailhead, so the search itself does not allocate once it has grown
+  std::vector<size_t> positionsToProcess{};
+
+  for (const Position* trailHead = firstTrailHead; trailHead != lastTrailHead; ++trailHead)
   {
-    std::vector<Position> positionsToProcess{trailHead};
+    positionsToProcess.push_back(map.getIndex(*trailHead));
 
     while (!positionsToProcess.empty())
     {
-      Position currentPosition = positionsToProcess.back();
+      size_t currentIndex = positionsToProcess.back();
       positionsToProcess.pop_back();
 
-      int height = map.get(currentPosition);
+      uint8_t height = heights[currentIndex];
       if (height == 9)
       {
-        // Part1 reachablePeaks[trailHead].insert(currentPosition);
-        reachablePeaks[trailHead].push_back(currentPosition);
+        // Part1 reachablePeaks[*trailHead].insert(map.getPosition(currentIndex));
+        reachablePeaks[*trailHead].push_back(map.getPosition(currentIndex));
+        continue;
       }
-      else
-      {
-        std::vector<Position> moveCandidates{
-            {.x = currentPosition.x, .y = currentPosition.y + 1},
-            {.x = currentPosition.x, .y = currentPosition.y - 1},
-            {.x = currentPosition.x - 1, .y = currentPosition.y},
-            {.x = currentPosition.x + 1, .y = currentPosition.y}};
 
-        for (const auto& moveCandidate : moveCandidates)
+      for (const auto& offset : neighborOffsets)
+      {
+        size_t moveCandidate = currentIndex + offset;
+        if (heights[moveCandidate] == height + 1)
         {
-          if (map.contains(moveCandidate) && (map.get(moveCandidate) == height + 1))
-          {
-            positionsToProcess.push_back(moveCandidate);
-          }
+          positionsToProcess.push_back(moveCandidate);
         }
       }
     }
   }
+}
+
+// Trailheads are independent, so with more than one worker they are split into contiguous
+// chunks. Every worker searches with its own stack into its own map, and the maps are
+// merged after all workers are done.
+ReachablePeaks calculateReachablePeaks(Map& map, size_t workerCount = 1)
+{
+  std::vector<Position> trailHeads = map.getTrailheads();
+  workerCount = std::clamp<size_t>(workerCount, 1, std::max<size_t>(trailHeads.size(), 1));
+
+  if (workerCount == 1)
+  {
+    ReachablePeaks reachablePeaks{};
+    collectReachablePeaks(map, trailHeads.data(), trailHeads.data() + trailHeads.size(), reachablePeaks);
+    return reachablePeaks;
+  }
+
+  size_t chunkSize = (trailHeads.size() + workerCount - 1) / workerCount;
+  std::vector<ReachablePeaks> workerReachablePeaks(workerCount);
+  std::vector<std::thread> workers{};
+
+  for (size_t worker = 0; worker < workerCount; ++worker)
+  {
+    size_t first = std::min(worker * chunkSize, trailHeads.size());
+    size_t last = std::min(first + chunkSize, trailHeads.size());
+
+    workers.emplace_back([&, first, last, worker] {
+      collectReachablePeaks(map, trailHeads.data() + first, trailHeads.data() + last, workerReachablePeaks[worker]);
+    });
+  }
+
+  ReachablePeaks reachablePeaks{};
+  for (size_t worker = 0; worker < workerCount; ++worker)
+  {
+    workers[worker].join();
+    reachablePeaks.merge(workerReachablePeaks[worker]);
+  }
 
   return reachablePeaks;
 }
@@ -214,8 +297,377 @@ long long calculateScore(ReachablePeaks& reachablePeaks)
   return score;
 }
 
-int main()
+// The DFS records a peak once per path, so distinct peaks are counted after sorting.
+long long calculateDistinctScore(ReachablePeaks& reachablePeaks)
 {
+  long long score = 0;
+
+  for (auto& [trailHead, peaks] : reachablePeaks)
+  {
+    std::sort(peaks.begin(), peaks.end(), [](const Position& a, const Position& b) {
+      return (a.y != b.y) ? (a.y < b.y) : (a.x < b.x);
+    });
+    score += std::unique(peaks.begin(), peaks.end()) - peaks.begin();
+  }
+
+  return score;
+}
+
+// Real cells below the peaks bucketed by height, each bucket in ascending index order.
+using HeightLayers = std::array<std::vector<size_t>, 9>;
+
+HeightLayers buildHeightLayers(const Map& map)
+{
+  const uint8_t* heights = map.getHeights();
+
+  HeightLayers layers{};
+  for (size_t index = 0; index < map.getPaddedSize(); ++index)
+  {
+    if (heights[index] < 9)
+    {
+      layers[heights[index]].push_back(index);
+    }
+  }
+  return layers;
+}
+
+std::vector<long long> calculatePathCounts(const Map& map, const HeightLayers& layers)
+{
+  const uint8_t* heights = map.getHeights();
+  const std::array<ptrdiff_t, 4> neighborOffsets = map.getNeighborOffsets();
+
+  std::vector<long long> pathCounts(map.getPaddedSize(), 0);
+  for (size_t index = 0; index < map.getPaddedSize(); ++index)
+  {
+    if (heights[index] == 9)
+    {
+      pathCounts[index] = 1;
+    }
+  }
+
+  for (int height = 8; height >= 0; --height)
+  {
+    for (const auto& index : layers[height])
+    {
+      for (const auto& offset : neighborOffsets)
+      {
+        size_t neighborIndex = index + offset;
+        if (heights[neighborIndex] == height + 1)
+        {
+          pathCounts[index] += pathCounts[neighborIndex];
+        }
+      }
+    }
+  }
+
+  return pathCounts;
+}
+
+// Propagates the reachable peaks in batches of 64 with one word per cell, so memory stays
+// linear in the number of cells. Peaks are numbered in row-major order, hence a batch
+// covers a narrow band of rows and only cells at most nine rows away can reach it.
+// visit(index, firstPeak, bits) is called for every cell reaching a peak of the batch,
+// with bit i standing for peak firstPeak + i. Batches are visited in ascending order.
+template <typename Visit>
+void forEachReachablePeakBatch(const Map& map, const HeightLayers& layers, Visit visit)
+{
+  std::vector<Position> peaks = map.getPeaks();
+  const uint8_t* heights = map.getHeights();
+  const std::array<ptrdiff_t, 4> neighborOffsets = map.getNeighborOffsets();
+  const size_t reach = 9 * static_cast<size_t>(neighborOffsets[0]);
+
+  std::vector<uint64_t> peakBits(map.getPaddedSize(), 0);
+
+  for (size_t firstPeak = 0; firstPeak < peaks.size(); firstPeak += 64)
+  {
+    size_t lastPeak = std::min(firstPeak + 64, peaks.size());
+    size_t firstIndex = map.getIndex(peaks[firstPeak]);
+    size_t lastIndex = map.getIndex(peaks[lastPeak - 1]);
+    size_t bandBegin = firstIndex - std::min(firstIndex, reach);
+    size_t bandEnd = std::min(lastIndex + reach + 1, map.getPaddedSize());
+
+    for (size_t peakIndex = firstPeak; peakIndex < lastPeak; ++peakIndex)
+    {
+      size_t index = map.getIndex(peaks[peakIndex]);
+      peakBits[index] = uint64_t{1} << (peakIndex - firstPeak);
+      visit(index, firstPeak, peakBits[index]);
+    }
+
+    for (int height = 8; height >= 0; --height)
+    {
+      const std::vector<size_t>& layer = layers[height];
+      auto first = std::lower_bound(layer.begin(), layer.end(), bandBegin);
+      auto last = std::lower_bound(first, layer.end(), bandEnd);
+
+      for (auto itr = first; itr != last; ++itr)
+      {
+        size_t index = *itr;
+        uint64_t bits = 0;
+
+        for (const auto& offset : neighborOffsets)
+        {
+          size_t neighborIndex = index + offset;
+          if (heights[neighborIndex] == height + 1)
+          {
+            bits |= peakBits[neighborIndex];
+          }
+        }
+
+        peakBits[index] = bits;
+        if (bits != 0)
+        {
+          visit(index, firstPeak, bits);
+        }
+      }
+    }
+
+    std::fill(peakBits.begin() + bandBegin, peakBits.begin() + bandEnd, 0);
+  }
+}
+
+struct TrailScores {
+  std::vector<long long> pathCounts{};
+  std::vector<long long> peakCounts{};
+};
+
+TrailScores calculateTrailScores(Map& map)
+{
+  HeightLayers layers = buildHeightLayers(map);
+
+  TrailScores trailScores{
+    .pathCounts = calculatePathCounts(map, layers),
+    .peakCounts = std::vector<long long>(map.getPaddedSize(), 0)
+  };
+
+  forEachReachablePeakBatch(map, layers, [&](size_t index, size_t, uint64_t bits) {
+    trailScores.peakCounts[index] += std::popcount(bits);
+  });
+
+  return trailScores;
+}
+
+// Answers score, rating and reachable-peak queries for any cell from tables built once.
+// Every cell keeps a sorted list of the peak indices it reaches, collected batch by batch
+// from the layered DP, since a cell usually reaches only a handful of the map's peaks.
+class TrailIndex {
+  Map& map;
+  std::vector<Position> peaks{};
+  std::vector<long long> pathCounts{};
+  std::vector<std::vector<uint32_t>> reachablePeaks{};
+
+public:
+  TrailIndex(Map& map)
+    : map{map}
+    , peaks{map.getPeaks()}
+  {
+    HeightLayers layers = buildHeightLayers(map);
+    pathCounts = calculatePathCounts(map, layers);
+    reachablePeaks.resize(map.getPaddedSize());
+
+    forEachReachablePeakBatch(map, layers, [&](size_t index, size_t firstPeak, uint64_t bits) {
+      for (; bits != 0; bits &= bits - 1)
+      {
+        reachablePeaks[index].push_back(static_cast<uint32_t>(firstPeak + std::countr_zero(bits)));
+      }
+    });
+  }
+
+  long long getRating(const Position& pos) const
+  {
+    return pathCounts[map.getIndex(pos)];
+  }
+
+  long long getScore(const Position& pos) const
+  {
+    return reachablePeaks[map.getIndex(pos)].size();
+  }
+
+  std::vector<Position> getReachablePeaks(const Position& pos) const
+  {
+    std::vector<Position> positions{};
+    for (const auto& peakIndex : reachablePeaks[map.getIndex(pos)])
+    {
+      positions.push_back(peaks[peakIndex]);
+    }
+    return positions;
+  }
+
+  // Peaks reachable from any cell within the rectangle spanned by both corners (inclusive).
+  std::vector<Position> getReachablePeaks(const Position& topLeft, const Position& bottomRight) const
+  {
+    std::vector<uint32_t> peakIndices{};
+    for (size_t y = topLeft.y; y <= bottomRight.y; ++y)
+    {
+      for (size_t x = topLeft.x; x <= bottomRight.x; ++x)
+      {
+        const auto& cellPeaks = reachablePeaks[map.getIndex({x, y})];
+        peakIndices.insert(peakIndices.end(), cellPeaks.begin(), cellPeaks.end());
+      }
+    }
+
+    std::sort(peakIndices.begin(), peakIndices.end());
+    peakIndices.erase(std::unique(peakIndices.begin(), peakIndices.end()), peakIndices.end());
+
+    std::vector<Position> positions{};
+    for (const auto& peakIndex : peakIndices)
+    {
+      positions.push_back(peaks[peakIndex]);
+    }
+    return positions;
+  }
+};
+
+long long calculateScore(Map& map, const TrailScores& trailScores)
+{
+  long long score = 0;
+
+  for (const auto& trailHead : map.getTrailheads())
+  {
+    score += trailScores.peakCounts[map.getIndex(trailHead)];
+  }
+
+  return score;
+}
+
+long long calculateRating(Map& map, const TrailScores& trailScores)
+{
+  long long rating = 0;
+
+  for (const auto& trailHead : map.getTrailheads())
+  {
+    rating += trailScores.pathCounts[map.getIndex(trailHead)];
+  }
+
+  return rating;
+}
+
+long long calculateScore(Map& map, const TrailIndex& trailIndex)
+{
+  long long score = 0;
+
+  for (const auto& trailHead : map.getTrailheads())
+  {
+    score += trailIndex.getScore(trailHead);
+  }
+
+  return score;
+}
+
+long long calculateRating(Map& map, const TrailIndex& trailIndex)
+{
+  long long rating = 0;
+
+  for (const auto& trailHead : map.getTrailheads())
+  {
+    rating += trailIndex.getRating(trailHead);
+  }
+
+  return rating;
+}
+
+// Square map following the diagonal pattern (x + y) % 10, which gives long branching
+// trails, with a quarter of the cells replaced by random heights.
+std::vector<std::string> generateMap(size_t size)
+{
+  std::mt19937 generator{2024};
+  std::uniform_int_distribution<int> height{0, 9};
+  std::bernoulli_distribution noise{0.25};
+
+  std::vector<std::string> lines(size, std::string(size, '0'));
+  for (size_t y = 0; y < size; ++y)
+  {
+    for (size_t x = 0; x < size; ++x)
+    {
+      lines[y][x] = intToChar(noise(generator) ? height(generator) : static_cast<int>((x + y) % 10));
+    }
+  }
+  return lines;
+}
+
+// Answers the reachable peaks of every trailhead once by DFS and once through the index.
+void benchmarkTrailIndex(size_t size)
+{
+  Map map{generateMap(size)};
+  std::vector<Position> trailHeads = map.getTrailheads();
+
+  std::cout << size << "x" << size << " map, " << trailHeads.size() << " trailheads, "
+    << map.getPeaks().size() << " peaks" << std::endl;
+
+  auto start = std::chrono::steady_clock::now();
+  ReachablePeaks reachablePeaks = calculateReachablePeaks(map);
+  long long dfsScore = calculateDistinctScore(reachablePeaks);
+  std::chrono::duration<double, std::milli> dfsTime = std::chrono::steady_clock::now() - start;
+
+  start = std::chrono::steady_clock::now();
+  TrailIndex trailIndex{map};
+  std::chrono::duration<double, std::milli> buildTime = std::chrono::steady_clock::now() - start;
+
+  start = std::chrono::steady_clock::now();
+  long long indexScore = 0;
+  for (const auto& trailHead : trailHeads)
+  {
+    indexScore += trailIndex.getReachablePeaks(trailHead).size();
+  }
+  std::chrono::duration<double, std::milli> queryTime = std::chrono::steady_clock::now() - start;
+
+  std::cout << "DFS:   " << dfsTime.count() << " ms (score " << dfsScore << ")" << std::endl;
+  std::cout << "Index: " << buildTime.count() << " ms build, " << queryTime.count()
+    << " ms queries (score " << indexScore << ")" << std::endl;
+}
+
+// Times the trailhead DFS with 1, 2, 4, ... workers up to maxWorkerCount.
+void benchmarkParallelSearch(size_t size, size_t maxWorkerCount)
+{
+  Map map{generateMap(size)};
+
+  std::cout << size << "x" << size << " map, " << map.getTrailheads().size() << " trailheads, "
+    << std::thread::hardware_concurrency() << " hardware threads" << std::endl;
+
+  double serialTime = 0;
+  for (size_t workerCount = 1; workerCount <= maxWorkerCount; workerCount *= 2)
+  {
+    auto start = std::chrono::steady_clock::now();
+    ReachablePeaks reachablePeaks = calculateReachablePeaks(map, workerCount);
+    std::chrono::duration<double, std::milli> duration = std::chrono::steady_clock::now() - start;
+
+    if (workerCount == 1)
+    {
+      serialTime = duration.count();
+    }
+
+    std::cout << "Workers: " << workerCount << " Time: " << duration.count() << " ms"
+      << " Speedup: " << serialTime / duration.count()
+      << " Rating: " << calculateScore(reachablePeaks) << std::endl;
+  }
+}
+
+int main(int argc, char** argv)
+{
+  size_t hardwareWorkers = std::max<size_t>(std::thread::hardware_concurrency(), 1);
+
+  if ((argc == 2) && std::string{argv[1]} == "-p")
+  {
+    Map map{"input.txt"};
+    ReachablePeaks reachablePeaks = calculateReachablePeaks(map, hardwareWorkers);
+
+    std::cout << "Workers: " << hardwareWorkers << std::endl;
+    std::cout << "Rating: " << calculateScore(reachablePeaks) << std::endl;
+    std::cout << "Score: " << calculateDistinctScore(reachablePeaks) << std::endl;
+    return 0;
+  }
+
+  if (((argc == 3) || (argc == 4)) && std::string{argv[1]} == "-s")
+  {
+    benchmarkParallelSearch(std::stoull(argv[2]), (argc == 4) ? std::stoull(argv[3]) : hardwareWorkers);
+    return 0;
+  }
+
+  if ((argc == 3) && std::string{argv[1]} == "-b")
+  {
+    benchmarkTrailIndex(std::stoull(argv[2]));
+    return 0;
+  }
+
   Map map{"input.txt"};
   map.print();
   std::cout << std::endl;
@@ -234,20 +686,10 @@ int main()
   }
   std::cout << std::endl << std::endl;
 
-  ReachablePeaks reachablePeaks = calculateReachablePeaks(map);
-  std::cout << "Reachable Peaks: " << std::endl;
-  for (const auto& [trailHead, peaks]: reachablePeaks)
-  {
-    std::cout << "\t[" << trailHead.x << ", " << trailHead.y << "]: ";
-    for (const auto& peak : peaks)
-    {
-      std::cout << "(" << peak.x << ", " << peak.y << ") ";
-    }
-    std::cout << std::endl;
-  }
-  std::cout << std::endl; 
+  TrailScores trailScores = calculateTrailScores(map);
 
-  std::cout << "Score: " << calculateScore(reachablePeaks) << std::endl;
+  std::cout << "Score: " << calculateScore(map, trailScores) << std::endl;
+  std::cout << "Rating: " << calculateRating(map, trailScores) << std::endl;
 
   return 0;
 }
\ No newline at end of file
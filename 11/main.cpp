@@ -1,13 +1,129 @@
+#include <array>
+#include <chrono>
+#include <cstdint>
 #include <fstream>
 #include <iostream>
+#include <optional>
 #include <sstream>
 #include <stdexcept>
 #include <string>
+#include <limits>
 #include <list>
 #include <unordered_map>
+#include <vector>
 
 using Stones = std::list<long long>;
 
+// Counter policies for the histogram solver, trading speed for range.
+
+// 64 bit counter that throws instead of wrapping around.
+struct CheckedCounter {
+  long long value = 0;
+
+  CheckedCounter& operator+=(const CheckedCounter& other)
+  {
+    if (other.value > std::numeric_limits<long long>::max() - value)
+    {
+      throw std::overflow_error{"Stone count exceeds 64 bit range."};
+    }
+    value += other.value;
+    return *this;
+  }
+};
+
+// 128 bit counter that throws instead of wrapping around.
+struct WideCounter {
+  unsigned __int128 value = 0;
+
+  WideCounter& operator+=(const WideCounter& other)
+  {
+    if (__builtin_add_overflow(value, other.value, &value))
+    {
+      throw std::overflow_error{"Stone count exceeds 128 bit range."};
+    }
+    return *this;
+  }
+};
+
+// Arbitrary precision counter, stored as base 10^9 limbs with the least significant limb first.
+class BigCounter {
+  static constexpr uint32_t LIMB_BASE = 1000000000;
+
+  std::vector<uint32_t> limbs{};
+
+public:
+  BigCounter(uint64_t value = 0)
+  {
+    for (; value > 0; value /= LIMB_BASE)
+    {
+      limbs.push_back(static_cast<uint32_t>(value % LIMB_BASE));
+    }
+  }
+
+  BigCounter& operator+=(const BigCounter& other)
+  {
+    if (limbs.size() < other.limbs.size())
+    {
+      limbs.resize(other.limbs.size(), 0);
+    }
+
+    uint32_t carry = 0;
+    for (size_t i = 0; i < limbs.size(); ++i)
+    {
+      uint32_t sum = limbs[i] + carry + ((i < other.limbs.size()) ? other.limbs[i] : 0);
+      carry = (sum >= LIMB_BASE) ? 1 : 0;
+      limbs[i] = sum - carry * LIMB_BASE;
+    }
+    if (carry > 0)
+    {
+      limbs.push_back(carry);
+    }
+    return *this;
+  }
+
+  std::string toString() const
+  {
+    if (limbs.empty())
+    {
+      return "0";
+    }
+
+    std::string digits = std::to_string(limbs.back());
+    for (auto itr = std::next(limbs.rbegin()); itr != limbs.rend(); ++itr)
+    {
+      std::string limb = std::to_string(*itr);
+      digits.append(9 - limb.size(), '0').append(limb);
+    }
+    return digits;
+  }
+};
+
+std::string toString(const CheckedCounter& counter)
+{
+  return std::to_string(counter.value);
+}
+
+std::string toString(const WideCounter& counter)
+{
+  unsigned __int128 value = counter.value;
+  std::string digits{};
+  do {
+    digits.insert(digits.begin(), static_cast<char>('0' + static_cast<int>(value % 10)));
+    value /= 10;
+  } while (value > 0);
+  return digits;
+}
+
+std::string toString(const BigCounter& counter)
+{
+  return counter.toString();
+}
+
+// Maps a stone inscription to the number of stones carrying it. Stones with equal
+// inscriptions always evolve the same way, so each distinct inscription is blinked once.
+template <typename Counter>
+using StoneHistogram = std::unordered_map<long long, Counter>;
+
 Stones readStones(std::string_view filePath)
 {
   Stones stones{};
@@ -42,13 +158,40 @@ void print(const Stones& stones)
   std::cout << std::endl;
 }
 
+constexpr std::array<long long, 19> POWERS_OF_TEN = [] {
+  std::array<long long, 19> powers{1};
+  for (size_t i = 1; i < powers.size(); ++i)
+  {
+    powers[i] = powers[i - 1] * 10;
+  }
+  return powers;
+}();
+
+size_t countDigits(long long stone)
+{
+  size_t numberOfDigits = 1;
+  while ((numberOfDigits < POWERS_OF_TEN.size()) && (stone >= POWERS_OF_TEN[numberOfDigits]))
+  {
+    ++numberOfDigits;
+  }
+  return numberOfDigits;
+}
+
+long long multiplyStone(long long stone)
+{
+  if (stone > std::numeric_limits<long long>::max() / 2024)
+  {
+    throw std::overflow_error{"Stone inscription exceeds 64 bit range."};
+  }
+  return stone * 2024;
+}
+
 void blink(Stones& stones)
 {
   for (auto itr = stones.begin(); itr != stones.end(); ++itr)
   {
     long long& stone = *itr;
-    std::string stoneInscription = std::to_string(stone);
-    size_t numberOfDigits = stoneInscription.size();
+    size_t numberOfDigits = countDigits(stone);
 
     if (*itr == 0)
     {
@@ -56,15 +199,15 @@ void blink(Stones& stones)
     }
     else if (numberOfDigits % 2 == 0)
     {
-      long long leftStone = std::stoll(stoneInscription.substr(0, numberOfDigits / 2));
-      long long rightStone = std::stoll(stoneInscription.substr(numberOfDigits / 2));
+      long long leftStone = stone / POWERS_OF_TEN[numberOfDigits / 2];
+      long long rightStone = stone % POWERS_OF_TEN[numberOfDigits / 2];
 
       stone = leftStone;
       itr = stones.insert(++itr, rightStone);
     }
     else
     {
-      (*itr) *= 2024;
+      (*itr) = multiplyStone(*itr);
     }
   }
 }
@@ -77,6 +220,92 @@ void blink(Stones& stones, size_t times)
   }
 }
 
+// Calls addStone for every stone a single stone turns into after one blink.
+template <typename Visitor>
+void forEachBlinkResult(long long stone, Visitor&& addStone)
+{
+  if (stone == 0)
+  {
+    addStone(1);
+    return;
+  }
+
+  size_t numberOfDigits = countDigits(stone);
+
+  if (numberOfDigits % 2 == 0)
+  {
+    addStone(stone / POWERS_OF_TEN[numberOfDigits / 2]);
+    addStone(stone % POWERS_OF_TEN[numberOfDigits / 2]);
+  }
+  else
+  {
+    addStone(multiplyStone(stone));
+  }
+}
+
+template <typename Counter>
+StoneHistogram<Counter> createHistogram(const Stones& stones)
+{
+  StoneHistogram<Counter> histogram{};
+  for (const auto& stone : stones)
+  {
+    histogram[stone] += Counter{1};
+  }
+  return histogram;
+}
+
+template <typename Counter>
+void blink(StoneHistogram<Counter>& histogram)
+{
+  StoneHistogram<Counter> nextHistogram{};
+  nextHistogram.reserve(histogram.size() * 2);
+
+  for (const auto& [stone, count] : histogram)
+  {
+    forEachBlinkResult(stone, [&nextHistogram, &count](long long newStone) { nextHistogram[newStone] += count; });
+  }
+
+  histogram = std::move(nextHistogram);
+}
+
+template <typename Counter = CheckedCounter>
+Counter calculateStonesCount(const Stones& stones, size_t numberOfBlinks)
+{
+  StoneHistogram<Counter> histogram = createHistogram<Counter>(stones);
+
+  for (size_t blinks = 0; blinks < numberOfBlinks; ++blinks)
+  {
+    blink(histogram);
+  }
+
+  Counter count{0};
+  for (const auto& [stone, stoneCount] : histogram)
+  {
+    count += stoneCount;
+  }
+  return count;
+}
+
+// Times blink on the stone list. Throughput counts every stone visited by a blink, i.e.
+// the list size before each of them.
+void benchmarkBlink(const Stones& stones, size_t numberOfBlinks)
+{
+  Stones stonesWorkingCopy{stones};
+  size_t processedStones = 0;
+
+  auto start = std::chrono::steady_clock::now();
+  for (size_t blinks = 0; blinks < numberOfBlinks; ++blinks)
+  {
+    processedStones += stonesWorkingCopy.size();
+    blink(stonesWorkingCopy);
+  }
+  std::chrono::duration<double> duration = std::chrono::steady_clock::now() - start;
+
+  std::cout << "Number of stones (" << numberOfBlinks << " blinks): " << stonesWorkingCopy.size() << std::endl;
+  std::cout << "Time: " << duration.count() * 1000 << " ms, "
+    << static_cast<double>(processedStones) / duration.count() << " stones/s" << std::endl;
+}
+
 long long calculateStonesSum(const Stones& stones, size_t numberOfBlinks)
 {
   Stones stonesWorkingCopy{stones};
@@ -87,108 +316,582 @@ long long calculateStonesSum(const Stones& stones, size_t numberOfBlinks)
 }
 
 
-long long calculateStoneSumDFS(long long initialStone, size_t numberOfBlinks)
-{
-  struct ProcessingNode{
-    long long inscription;
-    int height;
+// Memo for stone counts keyed on (inscription, remaining blinks). It is a flat
+// open-addressing table sized from a fixed memory budget. Lookups probe a short window
+// of slots; if an insert finds that window full, it evicts the entry with the fewest
+// remaining blinks, as that one is the cheapest to recompute.
+template <typename Counter>
+class StoneCountCache {
+  struct Entry {
+    long long stone;
+    size_t blinks; // 0 marks an empty slot, zero blinks are never cached
+    Counter count;
   };
-  std::vector<ProcessingNode> processingStack{{initialStone, 0}};
-  long long sum = 0;
 
-  while (!processingStack.empty())
+  static constexpr size_t PROBE_LIMIT = 8;
+
+  std::vector<Entry> entries{};
+  size_t mask = 0;
+
+  size_t getSlot(long long stone, size_t blinks) const
   {
-    ProcessingNode currentNode = processingStack.back();
-    processingStack.pop_back();
+    uint64_t hash = static_cast<uint64_t>(stone) ^ (static_cast<uint64_t>(blinks) * 0x9E3779B97F4A7C15ull);
+    hash = (hash ^ (hash >> 30)) * 0xBF58476D1CE4E5B9ull;
+    hash = (hash ^ (hash >> 27)) * 0x94D049BB133111EBull;
+    return (hash ^ (hash >> 31)) & mask;
+  }
 
-    if (currentNode.height == numberOfBlinks)
+public:
+  StoneCountCache(size_t memoryBudget)
+  {
+    size_t capacity = PROBE_LIMIT;
+    while (capacity * 2 * sizeof(Entry) <= memoryBudget)
     {
-      ++sum;
-      continue;
+      capacity *= 2;
     }
 
-    std::string stoneInscription = std::to_string(currentNode.inscription);
-    size_t numberOfDigits = stoneInscription.size();
+    entries.assign(capacity, Entry{0, 0, Counter{0}});
+    mask = capacity - 1;
+  }
 
-    if (numberOfDigits % 2 == 0)
+  std::optional<Counter> find(long long stone, size_t blinks) const
+  {
+    size_t slot = getSlot(stone, blinks);
+
+    for (size_t probe = 0; probe < PROBE_LIMIT; ++probe)
     {
-      long long leftStone = std::stoll(stoneInscription.substr(0, numberOfDigits / 2));
-      long long rightStone = std::stoll(stoneInscription.substr(numberOfDigits / 2));
+      const Entry& entry = entries[(slot + probe) & mask];
 
-      processingStack.push_back({rightStone, currentNode.height + 1});
-      processingStack.push_back({leftStone,  currentNode.height + 1});
+      if (entry.blinks == 0)
+      {
+        return std::nullopt;
+      }
+      if ((entry.stone == stone) && (entry.blinks == blinks))
+      {
+        return entry.count;
+      }
     }
-    else
+    return std::nullopt;
+  }
+
+  void insert(long long stone, size_t blinks, const Counter& count)
+  {
+    size_t slot = getSlot(stone, blinks);
+    Entry* victim = &entries[slot];
+
+    for (size_t probe = 0; probe < PROBE_LIMIT; ++probe)
     {
-      if (currentNode.inscription == 0)
+      Entry& entry = entries[(slot + probe) & mask];
+
+      if ((entry.blinks == 0) || ((entry.stone == stone) && (entry.blinks == blinks)))
       {
-        currentNode.inscription = 1;
+        victim = &entry;
+        break;
       }
-      else
+      if (entry.blinks < victim->blinks)
       {
-        currentNode.inscription *= 2024;
+        victim = &entry;
       }
-      ++currentNode.height;
-      processingStack.push_back(currentNode);
     }
+
+    *victim = {stone, blinks, count};
   }
+};
+
+constexpr size_t STONE_COUNT_CACHE_BUDGET = 32 * 1024 * 1024;
+
+// One pending (stone, blinks) pair of the DFS with the sum of the children finished so far.
+template <typename Counter>
+struct StoneSumFrame {
+  long long stone;
+  size_t blinks;
+  Counter sum;
+  std::array<long long, 2> children;
+  size_t childCount;
+  size_t nextChild;
+};
+
+// Iterative so the depth, which equals the number of blinks, is bounded by memory rather
+// than by the call stack.
+template <typename Counter>
+Counter calculateStoneSumDFS(long long stone, size_t numberOfBlinks, StoneCountCache<Counter>& cache)
+{
+  std::vector<StoneSumFrame<Counter>> frames{};
+  Counter result{0};
 
-  return sum;
-}
+  // Either resolves the pair into result right away or pushes a frame for it.
+  auto open = [&](long long stone, size_t blinks) {
+    if (blinks == 0)
+    {
+      result = Counter{1};
+      return false;
+    }
+
+    if (std::optional<Counter> cachedSum = cache.find(stone, blinks))
+    {
+      result = *cachedSum;
+      return false;
+    }
+
+    StoneSumFrame<Counter> frame{stone, blinks, Counter{0}, {}, 0, 0};
+    forEachBlinkResult(stone, [&frame](long long newStone) { frame.children[frame.childCount++] = newStone; });
+    frames.push_back(std::move(frame));
+    return true;
+  };
+
+  open(stone, numberOfBlinks);
+
+  while (!frames.empty())
+  {
+    StoneSumFrame<Counter>& frame = frames.back();
+
+    if (frame.nextChild == frame.childCount)
+    {
+      cache.insert(frame.stone, frame.blinks, frame.sum);
+      result = std::move(frame.sum);
+      frames.pop_back();
+
+      if (!frames.empty())
+      {
+        frames.back().sum += result;
+      }
+      continue;
+    }
 
-using ResultCache = std::unordered_map<long long, long long>;
+    long long child = frame.children[frame.nextChild++];
+    if (!open(child, frame.blinks - 1))
+    {
+      frames.back().sum += result;
+    }
+  }
+
+  return result;
+}
 
-long long calculateStoneSumDFSCached(long long stone, size_t numberOfBlinks, ResultCache& resultCache)
+// A single pass from the full blink count descends through every level at once, and once
+// the cache is smaller than the state space, evicted states are recomputed all the way
+// down, which cascades. Deepening one blink per pass avoids that: a pass only misses the
+// states its predecessor did not reach, and their children are the most recently cached
+// entries, which are the last ones the eviction gives up.
+template <typename Counter = CheckedCounter>
+Counter calculateStonesSumDFS(const Stones& stones, size_t numberOfBlinks)
 {
-  long long result = 0;
-  long long sum = 0;
+  Counter sum{0};
+  StoneCountCache<Counter> cache{STONE_COUNT_CACHE_BUDGET};
 
-  if (resultCache.contains(stone))
+  for (size_t blinks = 1; blinks < numberOfBlinks; ++blinks)
   {
-    sum += resultCache[stone];
+    for (const auto& stone : stones)
+    {
+      calculateStoneSumDFS(stone, blinks, cache);
+    }
   }
-  else
+
+  for (const auto& stone : stones)
   {
-    result = calculateStoneSumDFS(stone, numberOfBlinks);
-    resultCache[stone] = result;
-    sum += result;
+    sum += calculateStoneSumDFS(stone, numberOfBlinks, cache);
   }
+
   return sum;
 }
 
-long long calculateStonesSumDFS(const Stones& stones, size_t numberOfBlinks)
+// The stones reachable from the input form a small closed set of inscriptions, and one
+// blink is a fixed sparse linear map on the counts per inscription.
+struct StoneTransitions {
+  std::vector<long long> stones{};
+  std::vector<std::vector<size_t>> targets{};
+  std::vector<size_t> initialStones{};
+};
+
+StoneTransitions buildStoneTransitions(const Stones& stones)
 {
-  long long sum = 0;
-  size_t iterationSum = stones.size();
-  size_t iteration = 0;
+  StoneTransitions transitions{};
+  std::unordered_map<long long, size_t> stoneIndices{};
 
-  ResultCache resultCache;
-  long long result;
+  auto getIndex = [&](long long stone) {
+    auto [itr, inserted] = stoneIndices.try_emplace(stone, transitions.stones.size());
+    if (inserted)
+    {
+      transitions.stones.push_back(stone);
+    }
+    return itr->second;
+  };
 
   for (const auto& stone : stones)
   {
-    if ((iteration % 30000u) == 0u)
-      std::cout << "(" << iteration << "/" << iterationSum << ")\n";
+    transitions.initialStones.push_back(getIndex(stone));
+  }
 
-    iteration++;
-    sum += calculateStoneSumDFSCached(stone, numberOfBlinks, resultCache);
+  // stones grows while it is walked, which visits every inscription of the closed set once
+  for (size_t index = 0; index < transitions.stones.size(); ++index)
+  {
+    std::vector<size_t> targets{};
+    forEachBlinkResult(transitions.stones[index], [&](long long newStone) { targets.push_back(getIndex(newStone)); });
+    transitions.targets.push_back(targets);
   }
 
-  return sum;
+  return transitions;
 }
 
-int main()
+uint64_t mulMod(uint64_t a, uint64_t b, uint64_t modulus)
+{
+  return static_cast<uint64_t>(static_cast<unsigned __int128>(a) * b % modulus);
+}
+
+uint64_t powMod(uint64_t base, uint64_t exponent, uint64_t modulus)
+{
+  uint64_t result = 1 % modulus;
+  for (; exponent > 0; exponent >>= 1)
+  {
+    if (exponent & 1)
+    {
+      result = mulMod(result, base, modulus);
+    }
+    base = mulMod(base, base, modulus);
+  }
+  return result;
+}
+
+// Deterministic Miller-Rabin, the first twelve primes as bases decide every 64 bit number.
+bool isPrime(uint64_t n)
+{
+  constexpr std::array<uint64_t, 12> BASES{2, 3, 5, 7, 11, 13, 17, 19, 23, 29, 31, 37};
+
+  if (n < 2)
+  {
+    return false;
+  }
+  for (const auto& base : BASES)
+  {
+    if (n % base == 0)
+    {
+      return n == base;
+    }
+  }
+
+  uint64_t oddFactor = n - 1;
+  size_t twos = 0;
+  for (; (oddFactor & 1) == 0; oddFactor >>= 1)
+  {
+    ++twos;
+  }
+
+  for (const auto& base : BASES)
+  {
+    uint64_t x = powMod(base, oddFactor, n);
+    if ((x == 1) || (x == n - 1))
+    {
+      continue;
+    }
+
+    bool isWitness = true;
+    for (size_t i = 1; (i < twos) && isWitness; ++i)
+    {
+      x = mulMod(x, x, n);
+      isWitness = (x != n - 1);
+    }
+
+    if (isWitness)
+    {
+      return false;
+    }
+  }
+  return true;
+}
+
+// Berlekamp-Massey: the shortest recurrence s[i] = sum(c[j] * s[i - 1 - j]) producing the
+// sequence. Requires a prime modulus, since it divides by discrepancies.
+std::vector<uint64_t> findLinearRecurrence(const std::vector<uint64_t>& sequence, uint64_t modulus)
+{
+  std::vector<uint64_t> current{};
+  std::vector<uint64_t> previous{};
+  size_t previousFailure = 0;
+  uint64_t previousDiscrepancy = 1;
+  bool hasFailed = false;
+
+  for (size_t i = 0; i < sequence.size(); ++i)
+  {
+    uint64_t discrepancy = sequence[i];
+    for (size_t j = 0; j < current.size(); ++j)
+    {
+      discrepancy = (discrepancy + modulus - mulMod(current[j], sequence[i - 1 - j], modulus)) % modulus;
+    }
+
+    if (discrepancy == 0)
+    {
+      continue;
+    }
+
+    if (!hasFailed)
+    {
+      current.assign(i + 1, 0);
+      previousFailure = i;
+      previousDiscrepancy = discrepancy;
+      hasFailed = true;
+      continue;
+    }
+
+    uint64_t factor = mulMod(discrepancy, powMod(previousDiscrepancy, modulus - 2, modulus), modulus);
+    std::vector<uint64_t> next{current};
+    size_t shift = i - previousFailure - 1;
+
+    if (next.size() < previous.size() + shift + 1)
+    {
+      next.resize(previous.size() + shift + 1, 0);
+    }
+    next[shift] = (next[shift] + factor) % modulus;
+    for (size_t j = 0; j < previous.size(); ++j)
+    {
+      next[shift + 1 + j] = (next[shift + 1 + j] + modulus - mulMod(factor, previous[j], modulus)) % modulus;
+    }
+
+    if (i - current.size() >= previousFailure - previous.size())
+    {
+      previous = current;
+      previousFailure = i;
+      previousDiscrepancy = discrepancy;
+    }
+    current = std::move(next);
+  }
+
+  return current;
+}
+
+// Multiplies two polynomials of degree < recurrence.size() and reduces the product with
+// x^L = sum(c[j] * x^(L - 1 - j)).
+std::vector<uint64_t> mulModRecurrence(const std::vector<uint64_t>& a, const std::vector<uint64_t>& b,
+  const std::vector<uint64_t>& recurrence, uint64_t modulus)
+{
+  size_t order = recurrence.size();
+  std::vector<uint64_t> product(2 * order, 0);
+
+  for (size_t i = 0; i < order; ++i)
+  {
+    if (a[i] == 0)
+    {
+      continue;
+    }
+    for (size_t j = 0; j < order; ++j)
+    {
+      product[i + j] = (product[i + j] + mulMod(a[i], b[j], modulus)) % modulus;
+    }
+  }
+
+  for (size_t degree = 2 * order - 1; degree >= order; --degree)
+  {
+    if (product[degree] == 0)
+    {
+      continue;
+    }
+    for (size_t j = 0; j < order; ++j)
+    {
+      size_t target = degree - 1 - j;
+      product[target] = (product[target] + mulMod(product[degree], recurrence[j], modulus)) % modulus;
+    }
+  }
+
+  product.resize(order);
+  return product;
+}
+
+// Number of stones after numberOfBlinks blinks modulo a prime. The blink transition matrix
+// of the closed inscription set satisfies its minimal polynomial, so instead of squaring
+// the matrix itself the polynomial x^numberOfBlinks is reduced modulo the recurrence of
+// the stone counts by repeated squaring. Cost is independent of the blink count apart
+// from a logarithmic factor.
+// Berlekamp-Massey needs a field, so composite moduli fall back to stepping the sparse
+// counts one blink at a time, which is linear in the blink count.
+uint64_t calculateStonesCountModulo(const Stones& stones, uint64_t numberOfBlinks, uint64_t modulus)
+{
+  if (modulus < 2)
+  {
+    throw std::invalid_argument{"Modulus must be at least 2."};
+  }
+
+  StoneTransitions transitions = buildStoneTransitions(stones);
+
+  std::vector<uint64_t> counts(transitions.stones.size(), 0);
+  for (const auto& index : transitions.initialStones)
+  {
+    counts[index] = (counts[index] + 1) % modulus;
+  }
+
+  // the recurrence has at most one term per inscription, twice that many counts determine it
+  bool isPrimeModulus = isPrime(modulus);
+  std::vector<uint64_t> sequence{};
+  uint64_t sequenceLength = isPrimeModulus ? 2 * transitions.stones.size() + 2 : numberOfBlinks + 1;
+
+  for (uint64_t blinks = 0; blinks < sequenceLength; ++blinks)
+  {
+    uint64_t total = 0;
+    for (const auto& count : counts)
+    {
+      total = (total + count) % modulus;
+    }
+    if (isPrimeModulus)
+    {
+      sequence.push_back(total);
+    }
+
+    if (blinks == numberOfBlinks)
+    {
+      return total;
+    }
+
+    std::vector<uint64_t> nextCounts(counts.size(), 0);
+    for (size_t index = 0; index < counts.size(); ++index)
+    {
+      for (const auto& target : transitions.targets[index])
+      {
+        nextCounts[target] = (nextCounts[target] + counts[index]) % modulus;
+      }
+    }
+    counts = std::move(nextCounts);
+  }
+
+  std::vector<uint64_t> recurrence = findLinearRecurrence(sequence, modulus);
+  size_t order = recurrence.size();
+
+  if (order == 0)
+  {
+    return 0;
+  }
+
+  // x^numberOfBlinks mod the characteristic polynomial
+  std::vector<uint64_t> result(order, 0);
+  std::vector<uint64_t> base(order, 0);
+  result[0] = 1 % modulus;
+  if (order == 1)
+  {
+    base[0] = recurrence[0];
+  }
+  else
+  {
+    base[1] = 1;
+  }
+
+  for (uint64_t exponent = numberOfBlinks; exponent > 0; exponent >>= 1)
+  {
+    if (exponent & 1)
+    {
+      result = mulModRecurrence(result, base, recurrence, modulus);
+    }
+    base = mulModRecurrence(base, base, recurrence, modulus);
+  }
+
+  uint64_t total = 0;
+  for (size_t i = 0; i < order; ++i)
+  {
+    total = (total + mulMod(result[i], sequence[i], modulus)) % modulus;
+  }
+  return total;
+}
+
+// Runs count with the counter policy of the given name and formats its result.
+template <typename Count>
+std::string countWithPolicy(const std::string& counter, Count count)
+{
+  if (counter == "checked")
+  {
+    return toString(count(CheckedCounter{}));
+  }
+  if (counter == "int128")
+  {
+    return toString(count(WideCounter{}));
+  }
+  if (counter == "bignum")
+  {
+    return toString(count(BigCounter{}));
+  }
+  throw std::invalid_argument{"Unknown counter: " + counter};
+}
+
+template <typename Count>
+void printTimedCount(const std::string& name, Count count)
+{
+  auto start = std::chrono::steady_clock::now();
+  std::string result{};
+  try
+  {
+    result = count();
+  }
+  catch (const std::exception& e)
+  {
+    result = e.what();
+  }
+  std::chrono::duration<double, std::milli> duration = std::chrono::steady_clock::now() - start;
+
+  std::cout << name << ": " << duration.count() << " ms, " << result << std::endl;
+}
+
+// Times the histogram and the DFS once per counter policy.
+void benchmarkCounterPolicies(const Stones& stones, size_t numberOfBlinks)
+{
+  std::cout << "Counter policies (" << numberOfBlinks << " blinks)" << std::endl;
+
+  for (const std::string counter : {"checked", "int128", "bignum"})
+  {
+    printTimedCount(counter + " histogram", [&] {
+      return countWithPolicy(counter, [&](auto policy) { return calculateStonesCount<decltype(policy)>(stones, numberOfBlinks); });
+    });
+    printTimedCount(counter + " DFS", [&] {
+      return countWithPolicy(counter, [&](auto policy) { return calculateStonesSumDFS<decltype(policy)>(stones, numberOfBlinks); });
+    });
+  }
+}
+
+int main(int argc, char** argv)
 {
   Stones stones = readStones("input.txt");
   print(stones);
 
-  constexpr int MAX_BLINKS = 38;
-  blink(stones, 75 - MAX_BLINKS);
+  if ((argc == 4) && std::string{argv[1]} == "-m")
+  {
+    uint64_t numberOfBlinks = std::stoull(argv[2]);
+    uint64_t modulus = std::stoull(argv[3]);
+
+    std::cout << "Number of stones (" << numberOfBlinks << " blinks, mod " << modulus << "): "
+      << calculateStonesCountModulo(stones, numberOfBlinks, modulus) << std::endl;
+    return 0;
+  }
+
+  if ((argc == 4) && std::string{argv[1]} == "-c")
+  {
+    size_t numberOfBlinks = std::stoull(argv[2]);
+    std::string count = countWithPolicy(argv[3], [&](auto policy) {
+      return calculateStonesCount<decltype(policy)>(stones, numberOfBlinks);
+    });
+
+    std::cout << "Number of stones (" << numberOfBlinks << " blinks): " << count << std::endl;
+    return 0;
+  }
+
+  if ((argc == 3) && std::string{argv[1]} == "-p")
+  {
+    benchmarkCounterPolicies(stones, std::stoull(argv[2]));
+    return 0;
+  }
+
+  if ((argc == 3) && std::string{argv[1]} == "-b")
+  {
+    benchmarkBlink(stones, std::stoull(argv[2]));
+    return 0;
+  }
+
+  if (((argc == 3) || (argc == 4)) && std::string{argv[1]} == "-d")
+  {
+    size_t numberOfBlinks = std::stoull(argv[2]);
+    std::string count = countWithPolicy((argc == 4) ? argv[3] : "checked", [&](auto policy) {
+      return calculateStonesSumDFS<decltype(policy)>(stones, numberOfBlinks);
+    });
 
-  std::cout << "Number of stones: " << stones.size() << std::endl;
+    std::cout << "Number of stones (DFS, " << numberOfBlinks << " blinks): " << count << std::endl;
+    return 0;
+  }
 
-  long long sum = calculateStonesSumDFS(stones, MAX_BLINKS);
-  std::cout << "Number of stones (DFS): " << sum << std::endl;
+  std::cout << "Number of stones (25 blinks): " << toString(calculateStonesCount(stones, 25)) << std::endl;
+  std::cout << "Number of stones (75 blinks): " << toString(calculateStonesCount(stones, 75)) << std::endl;
+  std::cout << "Number of stones (DFS): " << toString(calculateStonesSumDFS(stones, 75)) << std::endl;
 
   return 0;
-}
\ No newline at end of file
+}
@@ -1,4 +1,3 @@
-#include <cstdlib>
 #include <iomanip>
 #include <iostream>
 #include <fstream>
@@ -8,7 +7,7 @@
 #include <vector>
 #include <limits>
 #include <array>
-#include <deque>
+#include <utility>
 
 enum class Direction {
   UP, DOWN, LEFT, RIGHT
@@ -156,6 +155,7 @@ PlantMap readPlantMap(std::string_view filePath)
 struct Region {
   long long area;
   long long perimeter;
+  long long sides;
   char plant;
   std::vector<Position> positions;
 
@@ -184,6 +184,39 @@ struct Region {
   }
 };
 
+bool isPlant(const PlantMap& map, const Position& pos, char plant)
+{
+  return (map.contains(pos) && (map.get(pos) == plant));
+}
+
+// A region has as many sides as corners. Each corner of the cell is checked via the 2x2
+// neighborhood it touches: it is convex if both orthogonal neighbors belong to another
+// region, and concave if both belong to the region but the diagonal one does not.
+int calculateNumberOfCorners(const Position& pos, const PlantMap& map, char plant)
+{
+  int numberOfCorners = 0;
+
+  for (const auto& [xDirection, yDirection] : std::array<std::pair<int, int>, 4>{{{1, 1}, {1, -1}, {-1, 1}, {-1, -1}}})
+  {
+    Position horizontalNeighbor{pos.x + xDirection, pos.y};
+    Position verticalNeighbor{pos.x, pos.y + yDirection};
+    Position diagonalNeighbor{pos.x + xDirection, pos.y + yDirection};
+
+    bool horizontalInRegion = isPlant(map, horizontalNeighbor, plant);
+    bool verticalInRegion = isPlant(map, verticalNeighbor, plant);
+
+    if (!horizontalInRegion && !verticalInRegion)
+    {
+      ++numberOfCorners;
+    }
+    else if (horizontalInRegion && verticalInRegion && !isPlant(map, diagonalNeighbor, plant))
+    {
+      ++numberOfCorners;
+    }
+  }
+  return numberOfCorners;
+}
+
 int calculateNumberOfFences(const Position& pos, const PlantMap& map, char plant)
 {
   int numberOfFences = 0;
@@ -210,6 +243,7 @@ void readRegionFloodFill(const PlantMap& map, Region& region, const Position& st
 
     ++region.area;
     region.perimeter += calculateNumberOfFences(currentPosition, map, region.plant);
+    region.sides += calculateNumberOfCorners(currentPosition, map, region.plant);
     region.positions.push_back(currentPosition);
 
     for (const auto& testPosition : getNeighbourPositions(currentPosition))
@@ -247,93 +281,271 @@ std::vector<Region> readRegions(const PlantMap& map)
   return regions;
 }
 
-bool areDirectNeighbors(const Position& posA, const Position& posB)
-{
-  int xA = posA.x;
-  int xB = posB.x;
-
-  int yA = posA.y;
-  int yB = posB.y;
-
-  return (((std::abs(xA - xB) == 1) && (yA == yB))
-    || ((std::abs(yA - yB) == 1) && (xA == xB)));
-}
+struct RegionStatistics {
+  long long area;
+  long long perimeter;
+  long long sides;
+};
 
-void extendSide(std::vector<Position>& edgesOfType, std::deque<Position>& side)
-{
-  bool foundAdditionalSideEdge = true;
+// Union-find over region labels. Merging two labels adds up their statistics in the root.
+class RegionLabels {
+  std::vector<size_t> parents{};
+  std::vector<RegionStatistics> statistics{};
 
-  while (foundAdditionalSideEdge)
+public:
+  size_t create(const RegionStatistics& initialStatistics = {})
   {
-    foundAdditionalSideEdge = false;
-
-    auto frontEdgeItr = std::find_if(
-        edgesOfType.begin(), edgesOfType.end(), [&side](const auto &upEdge) {
-          return areDirectNeighbors(side.front(), upEdge);
-        });
+    parents.push_back(parents.size());
+    statistics.push_back(initialStatistics);
+    return parents.size() - 1;
+  }
 
-    if (frontEdgeItr != edgesOfType.end())
+  size_t find(size_t label)
+  {
+    while (parents[label] != label)
     {
-      side.push_front(*frontEdgeItr);
-      edgesOfType.erase(frontEdgeItr);
-      foundAdditionalSideEdge = true;
+      parents[label] = parents[parents[label]];
+      label = parents[label];
     }
+    return label;
+  }
 
-    auto backEdgeItr = std::find_if(
-        edgesOfType.begin(), edgesOfType.end(), [&side](const auto &upEdge) {
-          return areDirectNeighbors(side.back(), upEdge);
-        });
+  void unite(size_t labelA, size_t labelB)
+  {
+    size_t rootA = find(labelA);
+    size_t rootB = find(labelB);
 
-    if (backEdgeItr != edgesOfType.end())
+    if (rootA == rootB)
     {
-      side.push_back(*backEdgeItr);
-      edgesOfType.erase(backEdgeItr);
-      foundAdditionalSideEdge = true;
+      return;
     }
+
+    parents[rootB] = rootA;
+    statistics[rootA].area += statistics[rootB].area;
+    statistics[rootA].perimeter += statistics[rootB].perimeter;
+    statistics[rootA].sides += statistics[rootB].sides;
   }
-}
 
-int countSidesOfType(std::vector<Position>& edgesOfType)
+  RegionStatistics& get(size_t label)
+  {
+    return statistics[find(label)];
+  }
+
+  size_t size() const
+  {
+    return parents.size();
+  }
+};
+
+struct Prices {
+  long long perimeterPrice;
+  long long sidePrice;
+};
+
+// Prices all regions while streaming the map row by row, keeping only two rows in memory.
+// Each row is labeled against the row above with union-find. Area, fences and corners are
+// accumulated per label from the two-row window; corners are taken from every 2x2 block of
+// cells around a grid vertex. A region is priced as soon as none of its cells appear in
+// the newest row, and the labels still in use are compacted after every row, so memory
+// stays proportional to the map width.
+Prices calculatePricesScanline(std::string_view filePath)
 {
-  int numberOfSides = 0;
-  while (!edgesOfType.empty())
+  constexpr char OUTSIDE = '\0';
+  constexpr size_t NO_LABEL = std::numeric_limits<size_t>::max();
+
+  std::string filePathTerminated{filePath};
+  std::fstream file{filePathTerminated};
+
+  if (!file.is_open())
   {
-    Position currentEdge = edgesOfType.back();
-    edgesOfType.pop_back();
+    throw std::runtime_error{"Unable to open file: " + filePathTerminated};
+  }
 
-    std::deque<Position> side{currentEdge};
-    extendSide(edgesOfType, side);
+  Prices prices{0, 0};
+  std::string currentRow{};
 
-    ++numberOfSides;
+  if (!std::getline(file, currentRow))
+  {
+    return prices;
   }
-  return numberOfSides;
-}
 
-int countSides(const Region& region, const PlantMap& map)
-{
-  int numberOfSides = 0;
+  size_t width = currentRow.size();
+  std::string previousRow(width, OUTSIDE);
+  std::vector<size_t> previousLabels(width, NO_LABEL);
+  std::vector<size_t> currentLabels(width, NO_LABEL);
+  RegionLabels labels{};
+  bool isLastRow = false;
+
+  auto isCorner = [](char plant, char horizontal, char vertical, char diagonal) {
+    return (((horizontal != plant) && (vertical != plant))
+      || ((horizontal == plant) && (vertical == plant) && (diagonal != plant)));
+  };
 
-  for (const auto& direction : DIRECT_NEIGHBOR_DIRECTIONS)
+  while (true)
   {
-    std::vector<Position> directedEdges{};
+    if (currentRow.size() != width)
+    {
+      throw std::runtime_error{"Rows of the plant map differ in length."};
+    }
 
-    for (const auto& pos : region.positions)
+    // label the current row against its left and upper neighbors
+    for (size_t x = 0; x < width; ++x)
     {
-      Position probePos{pos};
-      probePos.advance(direction);
+      currentLabels[x] = NO_LABEL;
+      if (currentRow[x] == OUTSIDE)
+      {
+        continue;
+      }
 
-      if (!map.contains(probePos) || (map.get(probePos) != region.plant))
+      if ((x > 0) && (currentRow[x - 1] == currentRow[x]))
+      {
+        currentLabels[x] = currentLabels[x - 1];
+      }
+      if (previousRow[x] == currentRow[x])
+      {
+        if (currentLabels[x] == NO_LABEL)
+        {
+          currentLabels[x] = previousLabels[x];
+        }
+        else
+        {
+          labels.unite(currentLabels[x], previousLabels[x]);
+        }
+      }
+      if (currentLabels[x] == NO_LABEL)
       {
-        directedEdges.push_back(pos);
+        currentLabels[x] = labels.create();
+      }
+
+      RegionStatistics& statistics = labels.get(currentLabels[x]);
+      ++statistics.area;
+      statistics.perimeter += ((x == 0) || (currentRow[x - 1] != currentRow[x])) ? 1 : 0;
+      statistics.perimeter += ((x == width - 1) || (currentRow[x + 1] != currentRow[x])) ? 1 : 0;
+    }
+
+    // fences between the two rows
+    for (size_t x = 0; x < width; ++x)
+    {
+      if (previousRow[x] == currentRow[x])
+      {
+        continue;
+      }
+      if (previousLabels[x] != NO_LABEL)
+      {
+        ++labels.get(previousLabels[x]).perimeter;
+      }
+      if (currentLabels[x] != NO_LABEL)
+      {
+        ++labels.get(currentLabels[x]).perimeter;
+      }
+    }
+
+    // corners at the vertices between the two rows
+    for (size_t vertex = 0; vertex <= width; ++vertex)
+    {
+      bool hasLeft = (vertex > 0);
+      bool hasRight = (vertex < width);
+
+      char topLeft = hasLeft ? previousRow[vertex - 1] : OUTSIDE;
+      char topRight = hasRight ? previousRow[vertex] : OUTSIDE;
+      char bottomLeft = hasLeft ? currentRow[vertex - 1] : OUTSIDE;
+      char bottomRight = hasRight ? currentRow[vertex] : OUTSIDE;
+
+      if ((topLeft != OUTSIDE) && isCorner(topLeft, topRight, bottomLeft, bottomRight))
+      {
+        ++labels.get(previousLabels[vertex - 1]).sides;
+      }
+      if ((topRight != OUTSIDE) && isCorner(topRight, topLeft, bottomRight, bottomLeft))
+      {
+        ++labels.get(previousLabels[vertex]).sides;
+      }
+      if ((bottomLeft != OUTSIDE) && isCorner(bottomLeft, bottomRight, topLeft, topRight))
+      {
+        ++labels.get(currentLabels[vertex - 1]).sides;
+      }
+      if ((bottomRight != OUTSIDE) && isCorner(bottomRight, bottomLeft, topRight, topLeft))
+      {
+        ++labels.get(currentLabels[vertex]).sides;
+      }
+    }
+
+    // price regions that did not continue into the current row
+    enum class LabelState : char { UNSEEN, CONTINUED, PRICED };
+    std::vector<LabelState> labelStates(labels.size(), LabelState::UNSEEN);
+
+    for (const auto& label : currentLabels)
+    {
+      if (label != NO_LABEL)
+      {
+        labelStates[labels.find(label)] = LabelState::CONTINUED;
       }
     }
-    numberOfSides += countSidesOfType(directedEdges);
+    for (const auto& label : previousLabels)
+    {
+      if (label == NO_LABEL)
+      {
+        continue;
+      }
+
+      size_t root = labels.find(label);
+      if (labelStates[root] == LabelState::UNSEEN)
+      {
+        const RegionStatistics& statistics = labels.get(root);
+        prices.perimeterPrice += statistics.area * statistics.perimeter;
+        prices.sidePrice += statistics.area * statistics.sides;
+        labelStates[root] = LabelState::PRICED;
+      }
+    }
+
+    if (isLastRow)
+    {
+      break;
+    }
+
+    // keep only the labels of the current row
+    RegionLabels compactedLabels{};
+    std::vector<size_t> compactedIds(labels.size(), NO_LABEL);
+
+    for (auto& label : currentLabels)
+    {
+      if (label == NO_LABEL)
+      {
+        continue;
+      }
+
+      size_t root = labels.find(label);
+      if (compactedIds[root] == NO_LABEL)
+      {
+        compactedIds[root] = compactedLabels.create(labels.get(root));
+      }
+      label = compactedIds[root];
+    }
+    labels = std::move(compactedLabels);
+
+    std::swap(previousRow, currentRow);
+    std::swap(previousLabels, currentLabels);
+
+    if (!std::getline(file, currentRow))
+    {
+      // a row of outside cells closes the remaining regions
+      currentRow.assign(width, OUTSIDE);
+      isLastRow = true;
+    }
   }
-  return numberOfSides;
+
+  return prices;
 }
 
-int main()
+int main(int argc, char** argv)
 {
+  if ((argc == 2) && std::string{argv[1]} == "-s")
+  {
+    Prices prices = calculatePricesScanline("input.txt");
+    std::cout << "Price (1): " << prices.perimeterPrice << std::endl;
+    std::cout << "Price (2): " << prices.sidePrice << std::endl;
+    return 0;
+  }
+
   PlantMap map = readPlantMap("input.txt");
   map.print();
 
@@ -343,7 +555,7 @@ int main()
   constexpr int OUTPUT_WIDTH = 3;
   for (const auto& region : regions)
   {
-    int sides = countSides(region, map);
+    long long sides = region.sides;
     std::cout << "Plant: " << region.plant
       << " Area: "      << std::setw(OUTPUT_WIDTH) << region.area
       << " Perimeter: " << std::setw(OUTPUT_WIDTH) << region.perimeter
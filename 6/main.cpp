@@ -1,7 +1,9 @@
+#include <algorithm>
 #include <iostream>
 #include <fstream>
 #include <stdexcept>
 #include <string>
+#include <vector>
 
 enum class Direction
 {
@@ -170,7 +172,20 @@ class Agent {
     Direction direction{};
   } state;
 
-  std::vector<Position> obstacleCandidates;
+  // The unmodified patrol up to the step into pos cannot be influenced by an obstacle at pos,
+  // so loop checks resume from where the candidate was first entered.
+  struct ObstacleCandidate {
+    Position pos;
+    Position entryPosition;
+    Direction entryDirection;
+    size_t turnRecordCount;
+  };
+
+  std::vector<ObstacleCandidate> obstacleCandidates;
+  std::vector<TurnRecord> patrolTurnRecords;
+
+  std::vector<bool> visitedPositions;
+  int visitedPositionCount = 0;
 
   enum class PatrolStatus {
     LOOP_DETECTED,
@@ -191,21 +206,49 @@ public:
 
   int getDistinctAgentPositions()
   {
-    return obstacleCandidates.size();
+    return visitedPositionCount;
+  }
+
+  bool markVisited(const Position& pos)
+  {
+    size_t index = pos.y * state.map.getSizeX() + pos.x;
+
+    if (visitedPositions[index])
+    {
+      return false;
+    }
+
+    visitedPositions[index] = true;
+    ++visitedPositionCount;
+
+    return true;
   }
 
   void findObstacleCandidates()
   {
       State stateBackup = state;
 
+      Position entryPosition{state.position};
+      Direction entryDirection{state.direction};
+      size_t turnRecordCount = state.turnRecords.size();
+
+      visitedPositions.assign(state.map.getSizeX() * state.map.getSizeY(), false);
+      visitedPositionCount = 0;
+      markVisited(state.position);
+
       while (patrol() == PatrolStatus::PROCESSING)
       {
-        if ((state.position != state.map.getStartPosition()) && (std::find(obstacleCandidates.begin(), obstacleCandidates.end(), state.position) == obstacleCandidates.end()))
+        if (markVisited(state.position))
         {
-          obstacleCandidates.push_back(state.position);
+          obstacleCandidates.push_back({state.position, entryPosition, entryDirection, turnRecordCount});
         }
+
+        entryPosition = state.position;
+        entryDirection = state.direction;
+        turnRecordCount = state.turnRecords.size();
       }
 
+      patrolTurnRecords = state.turnRecords;
       state = stateBackup;
   }
 
@@ -252,8 +295,12 @@ public:
     while (!obstacleCandidates.empty())
     {
       State stateBackup = state;
+      const ObstacleCandidate& candidate = obstacleCandidates.back();
 
-      state.map.setObstacle(obstacleCandidates.back());
+      state.map.setObstacle(candidate.pos);
+      state.position = candidate.entryPosition;
+      state.direction = candidate.entryDirection;
+      state.turnRecords.assign(patrolTurnRecords.begin(), patrolTurnRecords.begin() + candidate.turnRecordCount);
       obstacleCandidates.pop_back();
 
       PatrolStatus patrolStatus;
@@ -1,9 +1,14 @@
 
+#include <algorithm>
+#include <array>
 #include <iostream>
 #include <fstream>
+#include <limits>
+#include <numeric>
 #include <stdexcept>
 #include <string>
 #include <sstream>
+#include <thread>
 #include <vector>
 
 struct Equation {
@@ -43,106 +48,278 @@ Equations readInput(const std::string& filePath)
   return equations;
 }
 
-enum class Operation {
-  ADD,
-  MUL,
-  CONCAT
-};
+constexpr size_t MAX_EQUATION_NUMBERS = 64;
 
 struct MidResultNode {
   long long midResult;
   int nextNumberIndex;
-  std::vector<Operation> remainingOperations;
+  int nextOperationIndex;
 };
 
-long long applyOperator(long long a, long long b, Operation operation)
+constexpr std::array<long long, 19> POWERS_OF_TEN = [] {
+  std::array<long long, 19> powers{1};
+  for (size_t i = 1; i < powers.size(); ++i)
+  {
+    powers[i] = powers[i - 1] * 10;
+  }
+  return powers;
+}();
+
+// Returns the power of ten that shifts a number left by the decimal digits of b.
+constexpr long long getConcatShift(long long b)
 {
-  if (operation == Operation::ADD)
+  size_t digits = 1;
+  while ((digits < POWERS_OF_TEN.size()) && (b >= POWERS_OF_TEN[digits]))
+  {
+    ++digits;
+  }
+
+  if (digits >= POWERS_OF_TEN.size())
+  {
+    throw std::overflow_error("Concatenation overflows!");
+  }
+
+  return POWERS_OF_TEN[digits];
+}
+
+enum class Inversion {
+  // no value combined with b yields target, the branch is pruned
+  NONE,
+  // exactly the returned previous value yields target
+  UNIQUE,
+  // every value yields target (multiplying by 0 into a target of 0)
+  ANY
+};
+
+// Each operation combines a mid result a with the next number b (apply) and
+// reverses that step (invert).
+struct Add {
+  static constexpr long long apply(long long a, long long b)
   {
     return a + b;
   }
-  else if (operation == Operation::MUL)
+
+  static constexpr Inversion invert(long long target, long long b, long long& previous)
+  {
+    if (target < b)
+    {
+      return Inversion::NONE;
+    }
+    previous = target - b;
+    return Inversion::UNIQUE;
+  }
+};
+
+struct Mul {
+  static constexpr long long apply(long long a, long long b)
   {
     return a * b;
   }
-  else if (operation == Operation::CONCAT)
+
+  static constexpr Inversion invert(long long target, long long b, long long& previous)
   {
-    return std::stoll(std::to_string(a) + std::to_string(b));
+    if (b == 0)
+    {
+      return (target == 0) ? Inversion::ANY : Inversion::NONE;
+    }
+    if (target % b != 0)
+    {
+      return Inversion::NONE;
+    }
+    previous = target / b;
+    return Inversion::UNIQUE;
   }
-  else {
-    throw std::invalid_argument("Invalid operation!");
+};
+
+struct Concat {
+  static constexpr long long apply(long long a, long long b)
+  {
+    long long shift = getConcatShift(b);
+
+    if (a > (std::numeric_limits<long long>::max() - b) / shift)
+    {
+      throw std::overflow_error("Concatenation overflows!");
+    }
+    return a * shift + b;
   }
+
+  static constexpr Inversion invert(long long target, long long b, long long& previous)
+  {
+    long long shift = getConcatShift(b);
+
+    if (target % shift != b)
+    {
+      return Inversion::NONE;
+    }
+    previous = target / shift;
+    return Inversion::UNIQUE;
+  }
+};
+
+enum class OperatorSet {
+  ADD_MUL,
+  ADD_MUL_CONCAT
+};
+
+template <typename... Operators>
+Inversion invertOperator(int operatorIndex, long long target, long long b, long long& previous)
+{
+  int index = 0;
+  Inversion inversion = Inversion::NONE;
+
+  ((index++ == operatorIndex && (inversion = Operators::invert(target, b, previous), true)) || ...);
+
+  return inversion;
 }
 
+// Works backwards from the result, peeling numbers off the end. Operations whose
+// inverse does not exist (negative difference, remainder, mismatching suffix) cut
+// the branch right away. The stack holds at most one node per number, so it lives
+// in a fixed-size array and the search does not allocate.
+template <typename... Operators>
 bool isEquationValid(const Equation& equation)
 {
   auto& numbers = equation.numbers;
   auto& result = equation.result;
 
-  std::vector<MidResultNode> processingStack {{numbers.front(), 1, {Operation::ADD, Operation::MUL, Operation::CONCAT}}};
+  if (numbers.size() > MAX_EQUATION_NUMBERS)
+  {
+    throw std::invalid_argument("Equation has too many numbers!");
+  }
 
-  while (!processingStack.empty())
+  if (numbers.size() == 1)
   {
-    MidResultNode& node = processingStack.back();
+    return (numbers.front() == result);
+  }
+
+  std::array<MidResultNode, MAX_EQUATION_NUMBERS> processingStack;
+  size_t stackSize = 0;
+
+  processingStack[stackSize++] = {result, static_cast<int>(numbers.size()) - 1, 0};
+
+  while (stackSize > 0)
+  {
+    MidResultNode& node = processingStack[stackSize - 1];
     int nextNumberIndex = node.nextNumberIndex;
 
-    if ((nextNumberIndex >= numbers.size())
-      || node.remainingOperations.empty())
+    if (node.nextOperationIndex >= static_cast<int>(sizeof...(Operators)))
     {
-      processingStack.pop_back();
+      --stackSize;
       continue;
     }
 
-    // get next operation
-    Operation operation = node.remainingOperations.back();
-    node.remainingOperations.pop_back();
+    long long newMidResult = 0;
+    Inversion inversion = invertOperator<Operators...>(node.nextOperationIndex++, node.midResult, numbers[nextNumberIndex], newMidResult);
 
-    long long newMidResult = applyOperator(node.midResult, numbers[nextNumberIndex], operation);
-    if ((newMidResult == result) && (nextNumberIndex == numbers.size() - 1))
+    if (inversion == Inversion::NONE)
     {
+      continue;
+    }
+    if (inversion == Inversion::ANY)
+    {
+      // whatever the remaining numbers evaluate to
       return true;
     }
 
-    MidResultNode newNode{newMidResult, nextNumberIndex + 1, {Operation::ADD, Operation::MUL, Operation::CONCAT}};
-    processingStack.push_back(newNode);
+    if (nextNumberIndex == 1)
+    {
+      if (newMidResult == numbers.front())
+      {
+        return true;
+      }
+      continue;
+    }
+
+    processingStack[stackSize++] = {newMidResult, nextNumberIndex - 1, 0};
   }
   return false;
 }
 
-void filterInvalidEquations(Equations& equations)
+bool isEquationValid(const Equation& equation, OperatorSet operatorSet)
 {
-  Equations validEquations;
-  for (const auto& equation : equations)
+  switch (operatorSet) {
+    case OperatorSet::ADD_MUL:
+      return isEquationValid<Add, Mul>(equation);
+    case OperatorSet::ADD_MUL_CONCAT:
+      return isEquationValid<Add, Mul, Concat>(equation);
+    default:
+      throw std::invalid_argument("Invalid operator set!");
+  }
+}
+
+// Validates a contiguous chunk of equations. Valid equations are optionally written
+// into the chunk's own buffer so that workers never contend for std::cout.
+long long sumValidEquationResults(Equations::const_iterator begin, Equations::const_iterator end, OperatorSet operatorSet, std::string* output)
+{
+  long long sum = 0;
+
+  for (auto it = begin; it != end; ++it)
   {
-    if (isEquationValid(equation))
+    if (!isEquationValid(*it, operatorSet))
+    {
+      continue;
+    }
+
+    if (output != nullptr)
     {
-      validEquations.push_back(equation);
+      output->append(std::to_string(it->result)).append(": ");
+      for (const auto& number : it->numbers)
+      {
+        output->append(std::to_string(number)).append(" ");
+      }
+      output->append("\n");
     }
+    sum += it->result;
   }
 
-  equations = validEquations;
+  return sum;
 }
 
-long long sumValidEquationResults(Equations& equations)
+long long sumValidEquationResults(const Equations& equations, OperatorSet operatorSet, bool printValidEquations)
 {
-  long long sum = 0;
-  filterInvalidEquations(equations);
-  std::cout << std::endl;
-  for (auto& [result, numbers] : equations)
+  size_t workerCount = std::max(1u, std::thread::hardware_concurrency());
+  size_t chunkSize = (equations.size() + workerCount - 1) / workerCount;
+
+  std::vector<long long> partialSums(workerCount, 0);
+  std::vector<std::string> outputs(workerCount);
+  std::vector<std::thread> workers;
+
+  for (size_t worker = 0; worker < workerCount; ++worker)
   {
-    std::cout << result << ": ";
-    for (const auto& number : numbers)
+    size_t first = std::min(worker * chunkSize, equations.size());
+    size_t last = std::min(first + chunkSize, equations.size());
+    std::string* output = printValidEquations ? &outputs[worker] : nullptr;
+
+    workers.emplace_back([&, first, last, worker, output] {
+      partialSums[worker] = sumValidEquationResults(equations.begin() + first, equations.begin() + last, operatorSet, output);
+    });
+  }
+
+  for (auto& worker : workers)
+  {
+    worker.join();
+  }
+
+  if (printValidEquations)
+  {
+    for (const auto& output : outputs)
     {
-      std::cout << number << " ";
+      std::cout << output;
     }
-    std::cout << std::endl;
-    sum += result;
+    std::cout.flush();
   }
-  return sum;
+
+  return std::accumulate(partialSums.begin(), partialSums.end(), 0LL);
 }
 
-int main()
+int main(int argc, char** argv)
 {
   Equations equations = readInput("input.txt");
-  std::cout << "Sum: " << sumValidEquationResults(equations) << std::endl;
-}
\ No newline at end of file
+  bool printValidEquations = ((argc == 2) && std::string{argv[1]} == "-v");
+
+  long long sumTask1 = sumValidEquationResults(equations, OperatorSet::ADD_MUL, printValidEquations);
+  long long sumTask2 = sumValidEquationResults(equations, OperatorSet::ADD_MUL_CONCAT, printValidEquations);
+
+  std::cout << "Sum (task1): " << sumTask1 << std::endl;
+  std::cout << "Sum (task2): " << sumTask2 << std::endl;
+}
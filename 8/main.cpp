@@ -1,9 +1,19 @@
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <chrono>
+#include <cstdint>
 #include <iostream>
 #include <fstream>
+#include <iomanip>
+#include <limits>
 #include <sstream>
 #include <map>
+#include <numeric>
+#include <random>
 #include <stdexcept>
 #include <string>
+#include <thread>
 #include <vector>
 #include <unordered_set>
 
@@ -51,8 +61,18 @@ class Map {
       throw std::runtime_error{"Unable to open file: " + filePath};
     }
 
+    std::vector<std::string> lines{};
     std::string currentLine{};
     while (std::getline(file, currentLine))
+    {
+      lines.push_back(currentLine);
+    }
+    parse(lines);
+  }
+
+  void parse(const std::vector<std::string>& lines)
+  {
+    for (const auto& currentLine : lines)
     {
       std::vector<char> lineData{};
       std::stringstream ss{currentLine};
@@ -78,6 +98,11 @@ public:
     load(filePath);
   }
 
+  Map(const std::vector<std::string>& lines)
+  {
+    parse(lines);
+  }
+
   size_t getSizeX() const
   {
     return data.front().size();
@@ -85,7 +110,7 @@ public:
 
   size_t getSizeY() const
   {
-    return data.front().size();
+    return data.size();
   }
 
   bool isInMap(const Position& pos) const
@@ -114,7 +139,7 @@ public:
     data[pos.y][pos.x] = mark;
   }
 
-  TowerPositions getTowerPositions() const
+  const TowerPositions& getTowerPositions() const
   {
     return towerPositions;
   }
@@ -146,44 +171,107 @@ public:
   }
 };
 
-Positions calculateAntiNodePositionsOfTowerPair(const Map& map, const Position& posTowerA, const Position& posTowerB)
-{
-  Positions antiNodePositionsOfTowerPair{};
-
-  antiNodePositionsOfTowerPair.insert(posTowerA);
-  antiNodePositionsOfTowerPair.insert(posTowerB);
+// One bit per map cell, so all tower pairs write into the same grid without hashing.
+class PositionBitmap {
+  size_t sizeX;
+  std::vector<uint64_t> words;
 
-  size_t distanceX = posTowerB.x - posTowerA.x;
-  size_t distanceY = posTowerB.y - posTowerA.y;
+public:
+  PositionBitmap(size_t sizeX, size_t sizeY)
+    : sizeX{sizeX}
+    , words((sizeX * sizeY + 63) / 64, 0)
+  {
+  }
 
-  int stepFactorA = 1;
-  int stepFactorB = 1;
+  void set(const Position& pos)
+  {
+    size_t index = pos.y * sizeX + pos.x;
+    words[index / 64] |= (uint64_t{1} << (index % 64));
+  }
 
-  Position antiNodePosA{posTowerA.x - stepFactorA * distanceX, posTowerA.y - stepFactorA * distanceY};
-  Position antiNodePosB{posTowerB.x + stepFactorB * distanceX, posTowerB.y + stepFactorB * distanceY};
+  PositionBitmap& operator|=(const PositionBitmap& other)
+  {
+    for (size_t i = 0; i < words.size(); ++i)
+    {
+      words[i] |= other.words[i];
+    }
+    return *this;
+  }
 
-  while (map.isInMap(antiNodePosA))
+  size_t count() const
   {
-    antiNodePositionsOfTowerPair.insert(antiNodePosA);
+    size_t count = 0;
+    for (const auto& word : words)
+    {
+      count += std::popcount(word);
+    }
+    return count;
+  }
+};
+
+enum class AntiNodeMode {
+  // anti nodes repeat at whole multiples of the tower distance
+  RESONANT_HARMONICS,
+  // every grid cell on the line through both towers is an anti node
+  EVERY_LATTICE_POINT
+};
 
-    ++stepFactorA;
-    antiNodePosA = {posTowerA.x - stepFactorA * distanceX, posTowerA.y - stepFactorA * distanceY};
+// Narrows [minFactor, maxFactor] to the step factors k for which start + k * step stays within [0, size).
+void restrictStepFactors(long long start, long long step, long long size, long long& minFactor, long long& maxFactor)
+{
+  if (step > 0)
+  {
+    minFactor = std::max(minFactor, -(start / step));
+    maxFactor = std::min(maxFactor, (size - 1 - start) / step);
   }
-  while (map.isInMap(antiNodePosB))
+  else if (step < 0)
   {
-    antiNodePositionsOfTowerPair.insert(antiNodePosB);
+    minFactor = std::max(minFactor, -((size - 1 - start) / -step));
+    maxFactor = std::min(maxFactor, start / -step);
+  }
+}
+
+// Calls visit once for every anti node position of the tower pair, including the towers themselves.
+// The range of step factors that stays inside the map is computed up front, so the walk itself
+// needs no bounds checks.
+template <typename Visitor>
+void forEachAntiNodePositionOfTowerPair(const Map& map, const Position& posTowerA, const Position& posTowerB, AntiNodeMode mode, Visitor&& visit)
+{
+  long long stepX = static_cast<long long>(posTowerB.x) - static_cast<long long>(posTowerA.x);
+  long long stepY = static_cast<long long>(posTowerB.y) - static_cast<long long>(posTowerA.y);
 
-    ++stepFactorB;
-    antiNodePosB = {posTowerB.x + stepFactorB * distanceX, posTowerB.y + stepFactorB * distanceY};
+  if (mode == AntiNodeMode::EVERY_LATTICE_POINT)
+  {
+    long long divisor = std::gcd(stepX, stepY);
+    stepX /= divisor;
+    stepY /= divisor;
   }
 
-  return antiNodePositionsOfTowerPair;
+  long long minFactor = std::numeric_limits<long long>::min();
+  long long maxFactor = std::numeric_limits<long long>::max();
+
+  restrictStepFactors(posTowerA.x, stepX, map.getSizeX(), minFactor, maxFactor);
+  restrictStepFactors(posTowerA.y, stepY, map.getSizeY(), minFactor, maxFactor);
+
+  long long x = static_cast<long long>(posTowerA.x) + minFactor * stepX;
+  long long y = static_cast<long long>(posTowerA.y) + minFactor * stepY;
+
+  for (long long factor = minFactor; factor <= maxFactor; ++factor)
+  {
+    visit(Position{static_cast<size_t>(x), static_cast<size_t>(y)});
+
+    x += stepX;
+    y += stepY;
+  }
 }
 
-Positions calculateAntiNodePositionsOfFrequency(const Map& map, const Positions& towerPositions)
+void markAntiNodePositionsOfTowerPair(const Map& map, const Position& posTowerA, const Position& posTowerB, AntiNodeMode mode, PositionBitmap& antiNodePositions)
 {
-  Positions antiNodePositionsOfFrequency{};
+  forEachAntiNodePositionOfTowerPair(map, posTowerA, posTowerB, mode, [&](const Position& pos) { antiNodePositions.set(pos); });
+}
 
+void markAntiNodePositionsOfFrequency(const Map& map, const Positions& towerPositions, AntiNodeMode mode, PositionBitmap& antiNodePositions)
+{
   for (auto itrA = towerPositions.begin(); itrA != towerPositions.end(); ++itrA)
   {
     const Position& posA = *itrA;
@@ -191,34 +279,241 @@ Positions calculateAntiNodePositionsOfFrequency(const Map& map, const Positions&
     for (auto itrB = std::next(itrA); itrB != towerPositions.end(); ++itrB)
     {
       const Position& posB = *itrB;
-      Positions antiNodePositionsOfTowerPair = calculateAntiNodePositionsOfTowerPair(map, posA, posB);
-      antiNodePositionsOfFrequency.insert(antiNodePositionsOfTowerPair.begin(), antiNodePositionsOfTowerPair.end());
+      markAntiNodePositionsOfTowerPair(map, posA, posB, mode, antiNodePositions);
+    }
+  }
+}
+
+// Frequencies are independent, so workers pick them up one at a time and mark them
+// into private bitmaps. The bitmaps are OR-reduced once all workers are done.
+int countDistinctAntiNodePositions(const Map& map, AntiNodeMode mode, size_t workerCount = std::thread::hardware_concurrency())
+{
+  std::vector<const Positions*> frequencies{};
+  for (const auto& [frequency, towerPositions] : map.getTowerPositions())
+  {
+    frequencies.push_back(&towerPositions);
+  }
+
+  workerCount = std::clamp<size_t>(workerCount, 1, std::max<size_t>(frequencies.size(), 1));
+  std::vector<PositionBitmap> workerAntiNodePositions(workerCount, PositionBitmap{map.getSizeX(), map.getSizeY()});
+  std::atomic<size_t> nextFrequency{0};
+  std::vector<std::thread> workers{};
+
+  for (size_t worker = 0; worker < workerCount; ++worker)
+  {
+    workers.emplace_back([&, worker] {
+      for (size_t i = nextFrequency++; i < frequencies.size(); i = nextFrequency++)
+      {
+        markAntiNodePositionsOfFrequency(map, *frequencies[i], mode, workerAntiNodePositions[worker]);
+      }
+    });
+  }
+
+  PositionBitmap antiNodePositions{map.getSizeX(), map.getSizeY()};
+  for (size_t worker = 0; worker < workerCount; ++worker)
+  {
+    workers[worker].join();
+    antiNodePositions |= workerAntiNodePositions[worker];
+  }
+
+  return antiNodePositions.count();
+}
+
+// Keeps, per map cell, the number of tower pairs whose anti nodes cover it. Adding or
+// removing a tower only walks the pairs it forms within its own frequency, and the
+// distinct count changes whenever a cell's count moves between zero and non-zero.
+class AntiNodeIndex {
+  const Map& map;
+  AntiNodeMode mode;
+  TowerPositions towerPositions{};
+  std::vector<int> coverCounts;
+  size_t distinctAntiNodePositions = 0;
+
+  void updateCoverage(const Position& posTowerA, const Position& posTowerB, int delta)
+  {
+    forEachAntiNodePositionOfTowerPair(map, posTowerA, posTowerB, mode, [&](const Position& pos) {
+      int& coverCount = coverCounts[pos.y * map.getSizeX() + pos.x];
+
+      if ((coverCount == 0) && (delta > 0))
+      {
+        ++distinctAntiNodePositions;
+      }
+
+      coverCount += delta;
+
+      if ((coverCount == 0) && (delta < 0))
+      {
+        --distinctAntiNodePositions;
+      }
+    });
+  }
+
+public:
+  AntiNodeIndex(const Map& map, AntiNodeMode mode)
+    : map{map}
+    , mode{mode}
+    , coverCounts(map.getSizeX() * map.getSizeY(), 0)
+  {
+    for (const auto& [frequency, positions] : map.getTowerPositions())
+    {
+      for (const auto& position : positions)
+      {
+        addTower(frequency, position);
+      }
+    }
+  }
+
+  void addTower(char frequency, const Position& pos)
+  {
+    if (!map.isInMap(pos))
+    {
+      throw std::invalid_argument{"Position not in map!"};
+    }
+
+    Positions& positions = towerPositions[frequency];
+    if (!positions.insert(pos).second)
+    {
+      return;
+    }
+
+    for (const auto& other : positions)
+    {
+      if (other != pos)
+      {
+        updateCoverage(pos, other, 1);
+      }
+    }
+  }
+
+  void removeTower(char frequency, const Position& pos)
+  {
+    auto frequencyItr = towerPositions.find(frequency);
+    if ((frequencyItr == towerPositions.end()) || (frequencyItr->second.erase(pos) == 0))
+    {
+      return;
+    }
+
+    for (const auto& other : frequencyItr->second)
+    {
+      updateCoverage(pos, other, -1);
+    }
+  }
+
+  size_t countDistinctAntiNodePositions() const
+  {
+    return distinctAntiNodePositions;
+  }
+};
+
+// Square map of the given size with towersPerFrequency towers on random empty cells for
+// each frequency.
+std::vector<std::string> generateMap(size_t size, size_t frequencies, size_t towersPerFrequency)
+{
+  const std::string FREQUENCY_MARKS = "0123456789ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz";
+
+  if ((frequencies > FREQUENCY_MARKS.size()) || (frequencies * towersPerFrequency > size * size))
+  {
+    throw std::invalid_argument{"Too many towers for the map."};
+  }
+
+  std::vector<std::string> lines(size, std::string(size, '.'));
+  std::mt19937 generator{2024};
+  std::uniform_int_distribution<size_t> coordinate{0, size - 1};
+
+  for (size_t frequency = 0; frequency < frequencies; ++frequency)
+  {
+    for (size_t tower = 0; tower < towersPerFrequency; ++tower)
+    {
+      size_t x;
+      size_t y;
+      do {
+        x = coordinate(generator);
+        y = coordinate(generator);
+      } while (lines[y][x] != '.');
+
+      lines[y][x] = FREQUENCY_MARKS[frequency];
     }
   }
+  return lines;
+}
+
+void benchmarkAntiNodes(size_t size, size_t frequencies, size_t towersPerFrequency)
+{
+  Map map{generateMap(size, frequencies, towersPerFrequency)};
+  size_t hardwareWorkers = std::max<size_t>(std::thread::hardware_concurrency(), 1);
 
-  return antiNodePositionsOfFrequency;
+  std::cout << size << "x" << size << " map, " << frequencies << " frequencies, "
+    << towersPerFrequency << " towers per frequency" << std::endl;
+
+  for (size_t workerCount : {size_t{1}, hardwareWorkers})
+  {
+    auto start = std::chrono::steady_clock::now();
+    int antiNodes = countDistinctAntiNodePositions(map, AntiNodeMode::RESONANT_HARMONICS, workerCount);
+    std::chrono::duration<double, std::milli> duration = std::chrono::steady_clock::now() - start;
+
+    std::cout << "Workers: " << std::setw(3) << workerCount
+      << " Anti nodes: " << antiNodes
+      << " Time: " << duration.count() << " ms" << std::endl;
+  }
 }
 
-int countDistinctAntiNodePositions(Map& map)
+// Removes every tower from the index and adds it back again, checking the incremental
+// counts against the batch count of the map.
+bool checkAntiNodeIndex(const Map& map, AntiNodeMode mode)
 {
-  std::unordered_set<Position, Position::HashFunction> antiNodePositions{};
+  AntiNodeIndex index{map, mode};
+  size_t expected = countDistinctAntiNodePositions(map, mode);
 
-  for (const auto& [frequency, towerPositions] : map.getTowerPositions())
+  std::cout << "Number of distinct anti nodes (index): " << index.countDistinctAntiNodePositions() << std::endl;
+
+  for (const auto& [frequency, positions] : map.getTowerPositions())
   {
-    Positions antiNodePositionOfFrequency = calculateAntiNodePositionsOfFrequency(map, towerPositions);
-    antiNodePositions.insert(antiNodePositionOfFrequency.begin(), antiNodePositionOfFrequency.end());
+    for (const auto& position : positions)
+    {
+      index.removeTower(frequency, position);
+    }
+  }
+  std::cout << "After removing all towers: " << index.countDistinctAntiNodePositions() << std::endl;
+  bool valid = (index.countDistinctAntiNodePositions() == 0);
+
+  for (const auto& [frequency, positions] : map.getTowerPositions())
+  {
+    for (const auto& position : positions)
+    {
+      index.addTower(frequency, position);
+    }
   }
+  std::cout << "After adding them back: " << index.countDistinctAntiNodePositions() << std::endl;
+  valid = valid && (index.countDistinctAntiNodePositions() == expected);
 
-  return antiNodePositions.size();
+  std::cout << (valid ? "Index matches batch count" : "Index does NOT match batch count") << std::endl;
+  return valid;
 }
 
-int main()
+int main(int argc, char** argv)
 {
+  // A trailing -l counts every lattice point on the line instead of the resonant harmonics.
+  bool latticeMode = (argc >= 2) && std::string{argv[argc - 1]} == "-l";
+  AntiNodeMode mode = latticeMode ? AntiNodeMode::EVERY_LATTICE_POINT : AntiNodeMode::RESONANT_HARMONICS;
+  int modeArgc = latticeMode ? argc - 1 : argc;
+
+  if ((modeArgc == 2) && std::string{argv[1]} == "-i")
+  {
+    Map map{"input.txt"};
+    return checkAntiNodeIndex(map, mode) ? 0 : 1;
+  }
+
+  if ((argc == 5) && std::string{argv[1]} == "-b")
+  {
+    benchmarkAntiNodes(std::stoull(argv[2]), std::stoull(argv[3]), std::stoull(argv[4]));
+    return 0;
+  }
+
   Map map{"input.txt"};
   map.print();
   map.printTowerPositions();
 
-  std::cout << "Number of distinct anti nodes: " << countDistinctAntiNodePositions(map) << std::endl;
+  std::cout << "Number of distinct anti nodes: " << countDistinctAntiNodePositions(map, mode) << std::endl;
 
   return 0;
-}
\ No newline at end of file
+}
@@ -1,21 +1,38 @@
+#include <array>
+#include <cctype>
+#include <chrono>
+#include <cstdint>
 #include <cstdlib>
+#include <functional>
 #include <iostream>
 #include <fstream>
+#include <limits>
+#include <queue>
+#include <random>
 #include <stdexcept>
 #include <vector>
 #include <string>
 #include <algorithm>
 
-constexpr int START_ID = 0;
-constexpr int EMPTY_ENTRY_ID = -1;
+constexpr uint32_t START_ID = 0;
+constexpr uint32_t EMPTY_ENTRY_ID = std::numeric_limits<uint32_t>::max();
+constexpr uint32_t MAX_SPAN_SIZE = 9;
 
-using Filesystem = std::vector<long long>;
+// One block stores the id of the file it belongs to, or EMPTY_ENTRY_ID for free space.
+using Block = uint32_t;
+using Filesystem = std::vector<Block>;
 
 struct Record
 {
-  int id;
-  int size;
-  int originalPosition;
+  uint32_t id;
+  uint32_t size;
+  uint64_t position;
+};
+
+struct DiskMap
+{
+  std::vector<Record> files;
+  std::vector<Record> freeSpaces;
 };
 
 std::string readFilesystem(const std::string& filePath)
@@ -42,16 +59,17 @@ char intToChar(int i)
   return static_cast<int>('0' + i);
 }
 
-Filesystem expandFilesystem(const std::string& filesystem)
+template <typename BlockType>
+std::vector<BlockType> expandBlocks(const std::string& filesystem, BlockType emptyId)
 {
-  Filesystem expandedFileSystem{};
+  std::vector<BlockType> expandedFileSystem{};
 
   bool fileExpansion = true;
-  int currentId = START_ID;
+  BlockType currentId = START_ID;
 
   for (const char c : filesystem)
   {
-    int multiplicity = charToInt(c);
+    uint32_t multiplicity = charToInt(c);
 
     if (fileExpansion)
     {
@@ -59,193 +77,407 @@ Filesystem expandFilesystem(const std::string& filesystem)
     }
     else
     {
-      expandedFileSystem.insert(expandedFileSystem.end(), multiplicity, EMPTY_ENTRY_ID);
+      expandedFileSystem.insert(expandedFileSystem.end(), multiplicity, emptyId);
     }
     fileExpansion = !fileExpansion;
   }
   return expandedFileSystem;
 }
 
-Filesystem sortFileSystem(const Filesystem& expandedFilesystem)
+Filesystem expandFilesystem(const std::string& filesystem)
 {
-  Filesystem sortedFilesystem{expandedFilesystem};
-  size_t insertIndex = 0;
-  size_t copyIndex = expandedFilesystem.size() - 1;
+  return expandBlocks<Block>(filesystem, EMPTY_ENTRY_ID);
+}
 
-  while (insertIndex != copyIndex)
+void printFilesystem(const Filesystem& expandedFilesystem)
+{
+  for (const auto fileID : expandedFilesystem)
   {
-    if (sortedFilesystem[insertIndex] == EMPTY_ENTRY_ID)
+    if (fileID == EMPTY_ENTRY_ID)
     {
-      while (expandedFilesystem[copyIndex] == EMPTY_ENTRY_ID)
-      {
-        --copyIndex;
-      }
-
-      std::swap(sortedFilesystem[insertIndex], sortedFilesystem[copyIndex]);
-      --copyIndex;
+      std::cout << '.';
+    }
+    else
+    {
+      std::cout << fileID;
     }
+  }
+  std::cout << std::endl;
+}
+
+DiskMap parseDiskMap(const std::string& filesystem)
+{
+  DiskMap diskMap{};
+
+  bool fileEntry = true;
+  uint32_t currentId = START_ID;
+  uint64_t position = 0;
+
+  for (const char c : filesystem)
+  {
+    uint32_t size = charToInt(c);
 
-    ++insertIndex;
+    if (fileEntry)
+    {
+      diskMap.files.push_back({currentId++, size, position});
+    }
+    else
+    {
+      diskMap.freeSpaces.push_back({EMPTY_ENTRY_ID, size, position});
+    }
+    position += size;
+    fileEntry = !fileEntry;
   }
-  return sortedFilesystem;
+  return diskMap;
 }
 
-std::vector<Record> findFreeSpaces(const Filesystem& expandedFilesystem)
+// Moves single blocks from the end of the disk into the free spans from left to right.
+// Works on the file and free-span runs only, splitting the last file whenever a free
+// span cannot take all of its remaining blocks.
+std::vector<Record> compactBlocks(const DiskMap& diskMap)
 {
-  std::vector<Record> freeSpaces{};
+  const auto& files = diskMap.files;
+  std::vector<Record> compactedFiles{};
+
+  if (files.empty())
+  {
+    return compactedFiles;
+  }
 
-  bool newEntry = true;
-  Record currentRecord{};
+  size_t lastFile = files.size() - 1;
+  uint32_t remainingBlocks = files[lastFile].size;
 
-  for (size_t i = 0; i < expandedFilesystem.size(); ++i)
+  for (size_t i = 0; i <= lastFile; ++i)
   {
-    int id = expandedFilesystem[i];
+    if (i == lastFile)
+    {
+      compactedFiles.push_back({files[i].id, remainingBlocks, files[i].position});
+      break;
+    }
+    compactedFiles.push_back(files[i]);
 
-    if (id != EMPTY_ENTRY_ID)
+    if (i >= diskMap.freeSpaces.size())
     {
-      if (!newEntry)
+      continue;
+    }
+
+    uint64_t freePosition = diskMap.freeSpaces[i].position;
+    uint32_t freeSize = diskMap.freeSpaces[i].size;
+
+    while ((freeSize > 0) && (lastFile > i))
+    {
+      uint32_t movedBlocks = std::min(freeSize, remainingBlocks);
+
+      if (movedBlocks > 0)
       {
-        freeSpaces.push_back(currentRecord);
-        newEntry = true;
+        compactedFiles.push_back({files[lastFile].id, movedBlocks, freePosition});
+      }
+      freePosition += movedBlocks;
+      freeSize -= movedBlocks;
+      remainingBlocks -= movedBlocks;
+
+      if (remainingBlocks == 0)
+      {
+        --lastFile;
+        remainingBlocks = files[lastFile].size;
       }
-      continue;
     }
+  }
+
+  return compactedFiles;
+}
+
+// Free spans are kept in one min-heap of (position, size) per span size, with spans longer
+// than MAX_SPAN_SIZE sharing the last heap. Moving a file only needs to look at the heap
+// tops for sizes that fit, and a partially used span goes back into the heap of its
+// remaining size. Space freed by a moved file is never reused, since every file still to
+// be processed lies to the left of it.
+std::vector<Record> compactFiles(const DiskMap& diskMap)
+{
+  using FreeSpan = std::pair<uint64_t, uint32_t>;
+  using FreeSpanHeap = std::priority_queue<FreeSpan, std::vector<FreeSpan>, std::greater<FreeSpan>>;
+  std::array<FreeSpanHeap, MAX_SPAN_SIZE + 1> freeSpans{};
 
-    if (newEntry)
+  // a zero length file does not separate the free spans around it
+  std::vector<Record> freeSpaces{};
+  for (size_t i = 0; i < diskMap.freeSpaces.size(); ++i)
+  {
+    if (!freeSpaces.empty() && (diskMap.files[i].size == 0))
     {
-      newEntry = false;
-      currentRecord.id = id;
-      currentRecord.size = 1;
-      currentRecord.originalPosition = i;
+      freeSpaces.back().size += diskMap.freeSpaces[i].size;
     }
     else
     {
-      ++currentRecord.size;
+      freeSpaces.push_back(diskMap.freeSpaces[i]);
     }
   }
-  return freeSpaces;
-}
 
-std::vector<Record> findFiles(const Filesystem& expandedFilesystem)
-{
-  std::vector<Record> files{};
+  for (const auto& freeSpace : freeSpaces)
+  {
+    if (freeSpace.size > 0)
+    {
+      freeSpans[std::min(freeSpace.size, MAX_SPAN_SIZE)].push({freeSpace.position, freeSpace.size});
+    }
+  }
 
-  Record currentRecord{};
-  bool newRecord = true;
+  std::vector<Record> files{diskMap.files};
 
-  for (size_t i = 0; i < expandedFilesystem.size(); ++i)
+  for (auto fileItr = files.rbegin(); fileItr != files.rend(); ++fileItr)
   {
-    int id = expandedFilesystem[i];
+    Record& file = *fileItr;
 
-    if (id == EMPTY_ENTRY_ID)
+    if (file.size == 0)
     {
       continue;
     }
 
-    if (newRecord)
+    uint32_t spanHeap = 0;
+    uint64_t spanPosition = file.position;
+
+    for (uint32_t size = file.size; size <= MAX_SPAN_SIZE; ++size)
     {
-      currentRecord.id = id;
-      currentRecord.originalPosition = i;
-      currentRecord.size = 1;
-      newRecord = false;
+      if (!freeSpans[size].empty() && (freeSpans[size].top().first < spanPosition))
+      {
+        spanHeap = size;
+        spanPosition = freeSpans[size].top().first;
+      }
     }
-    else
+
+    if (spanHeap == 0)
     {
-      ++currentRecord.size;
+      continue;
     }
 
-    if ((i == expandedFilesystem.size() - 1) || (expandedFilesystem[i + 1] != id))
+    uint32_t spanSize = freeSpans[spanHeap].top().second;
+    freeSpans[spanHeap].pop();
+    file.position = spanPosition;
+
+    if (spanSize > file.size)
     {
-      files.push_back(currentRecord);
-      newRecord = true;
+      uint32_t remainingSize = spanSize - file.size;
+      freeSpans[std::min(remainingSize, MAX_SPAN_SIZE)].push({spanPosition + file.size, remainingSize});
     }
   }
+
   return files;
 }
 
-void printFilesystem(const Filesystem& expandedFilesystem)
+// Each record contributes id * (position + ... + position + size - 1), which is summed in closed form.
+uint64_t calculateChecksum(const std::vector<Record>& files)
 {
-  for (const auto fileID : expandedFilesystem)
+  uint64_t checksum = 0;
+
+  for (const auto& file : files)
   {
-    if (fileID == EMPTY_ENTRY_ID)
+    uint64_t size = file.size;
+    uint64_t positionSum = size * file.position + size * (size - 1) / 2;
+    checksum += file.id * positionSum;
+  }
+
+  return checksum;
+}
+
+// Reads single digits of the disk map straight from the file through a small fixed-size
+// window, so the map never has to be held in memory. Each cursor owns its own stream and
+// window, which lets one cursor move forward while another moves backward.
+class DiskMapReader
+{
+  static constexpr size_t WINDOW_SIZE = 1 << 16;
+
+  std::ifstream file;
+  std::array<char, WINDOW_SIZE> window{};
+  size_t windowStart = 0;
+  size_t windowSize = 0;
+  size_t length = 0;
+
+  // Returns the character at index, refilling the window so that it is centered on index.
+  char read(size_t index)
+  {
+    if ((index < windowStart) || (index >= windowStart + windowSize))
     {
-      std::cout << '.';
+      windowStart = (index > WINDOW_SIZE / 2) ? index - WINDOW_SIZE / 2 : 0;
+
+      file.clear();
+      file.seekg(static_cast<std::streamoff>(windowStart));
+      file.read(window.data(), WINDOW_SIZE);
+      windowSize = static_cast<size_t>(file.gcount());
     }
-    else
+    return window[index - windowStart];
+  }
+
+public:
+  DiskMapReader(const std::string& filePath)
+    : file{filePath, std::ios::binary}
+  {
+    if (!file.is_open())
     {
-      std::cout << fileID;
+      throw std::runtime_error("Unable to open file: " + filePath);
+    }
+
+    file.seekg(0, std::ios::end);
+    length = static_cast<size_t>(file.tellg());
+
+    // ignore the trailing line break
+    while ((length > 0) && !std::isdigit(static_cast<unsigned char>(read(length - 1))))
+    {
+      --length;
     }
   }
-  std::cout << std::endl;
-}
 
-void swapRecords(Filesystem& expandedFilesystem, Record& src, Record& dest)
-{
-  for (size_t i = 0; i < src.size; ++i)
+  size_t size() const
   {
-    std::swap(expandedFilesystem[src.originalPosition + i],
-      expandedFilesystem[dest.originalPosition + i]);
+    return length;
   }
-}
 
-Filesystem sortFiles(const Filesystem& expandedFilesystem)
+  int at(size_t index)
+  {
+    return charToInt(read(index));
+  }
+};
+
+// Part 1 without expansion: a forward cursor walks the runs from the left while a
+// backward cursor hands out the blocks of the last unmoved file, and the checksum
+// of every emitted run is added immediately.
+uint64_t calculateStreamingChecksum(const std::string& filePath)
 {
-  Filesystem sortedFilesystem{expandedFilesystem};
-  std::vector<Record> files = findFiles(expandedFilesystem);
+  DiskMapReader forward{filePath};
+  DiskMapReader backward{filePath};
 
-  while (!files.empty())
+  if (forward.size() == 0)
   {
-    Record currentFile = files.back();
-    files.pop_back();
+    return 0;
+  }
+
+  auto runChecksum = [](uint64_t id, uint64_t size, uint64_t position) {
+    return id * (size * position + size * (size - 1) / 2);
+  };
 
-    std::vector<Record> freeSpaces = findFreeSpaces(sortedFilesystem);
-    auto freeSlotItr = std::find_if(freeSpaces.begin(), freeSpaces.end(),
-      [&currentFile](const auto& record)
-      { return ((record.size >= currentFile.size)
-        && (record.originalPosition < currentFile.originalPosition));
-      });
+  uint64_t checksum = 0;
+  uint64_t position = 0;
 
-    if (freeSlotItr == freeSpaces.end())
+  uint64_t lastFile = (forward.size() - 1) & ~uint64_t{1};
+  uint64_t remainingBlocks = backward.at(lastFile);
+
+  for (uint64_t i = 0; i <= lastFile; ++i)
+  {
+    if (i % 2 == 0)
     {
+      uint64_t size = (i == lastFile) ? remainingBlocks : forward.at(i);
+
+      checksum += runChecksum(i / 2, size, position);
+      position += size;
       continue;
     }
 
-    swapRecords(sortedFilesystem, currentFile, *freeSlotItr);
+    uint64_t freeSize = forward.at(i);
+
+    while ((freeSize > 0) && (lastFile > i))
+    {
+      uint64_t movedBlocks = std::min(freeSize, remainingBlocks);
+
+      checksum += runChecksum(lastFile / 2, movedBlocks, position);
+      position += movedBlocks;
+      freeSize -= movedBlocks;
+      remainingBlocks -= movedBlocks;
+
+      if (remainingBlocks == 0)
+      {
+        lastFile -= 2;
+        remainingBlocks = (lastFile > i) ? backward.at(lastFile) : 0;
+      }
+    }
   }
 
-  return sortedFilesystem;
+  return checksum;
 }
 
-long long calculateChecksum(const Filesystem& expandedFilesystem)
+// Checksum over an expanded filesystem, skipping the free blocks.
+template <typename BlockType>
+uint64_t calculateBlockChecksum(const std::vector<BlockType>& blocks, BlockType emptyId)
 {
-  size_t position = 0;
-  long long checksum = 0;
-
-  for (const auto& id : expandedFilesystem)
+  uint64_t checksum = 0;
+  for (uint64_t position = 0; position < blocks.size(); ++position)
   {
-    if (id != EMPTY_ENTRY_ID)
+    if (blocks[position] != emptyId)
     {
-      checksum += id * position;
+      checksum += position * static_cast<uint64_t>(blocks[position]);
     }
-    ++position;
   }
-
   return checksum;
 }
 
+// Random disk map that expands to at least the given number of blocks.
+std::string generateDiskMap(uint64_t blocks)
+{
+  std::mt19937 generator{2024};
+  std::uniform_int_distribution<int> fileSize{1, MAX_SPAN_SIZE};
+  std::uniform_int_distribution<int> freeSize{0, MAX_SPAN_SIZE};
+
+  std::string filesystem{};
+  uint64_t expandedSize = 0;
+  bool fileExpansion = true;
+
+  while (expandedSize < blocks)
+  {
+    int size = fileExpansion ? fileSize(generator) : freeSize(generator);
+    filesystem.push_back(intToChar(size));
+    expandedSize += size;
+    fileExpansion = !fileExpansion;
+  }
+  return filesystem;
+}
+
+template <typename BlockType>
+void benchmarkBlocks(const std::string& name, const std::string& filesystem, BlockType emptyId)
+{
+  auto start = std::chrono::steady_clock::now();
+  std::vector<BlockType> blocks = expandBlocks<BlockType>(filesystem, emptyId);
+  auto expanded = std::chrono::steady_clock::now();
+  uint64_t checksum = calculateBlockChecksum(blocks, emptyId);
+  auto end = std::chrono::steady_clock::now();
+
+  std::chrono::duration<double, std::milli> expandTime = expanded - start;
+  std::chrono::duration<double, std::milli> checksumTime = end - expanded;
+
+  std::cout << name << ": " << blocks.size() * sizeof(BlockType) / (1024 * 1024) << " MiB"
+    << ", expand: " << expandTime.count() << " ms"
+    << ", checksum: " << checksumTime.count() << " ms"
+    << " (" << checksum << ")" << std::endl;
+}
+
+// Compares the former long long representation of the expanded filesystem with the
+// packed Block representation.
+void benchmarkRepresentations(uint64_t blocks)
+{
+  std::string filesystem = generateDiskMap(blocks);
+
+  std::cout << "Disk map of " << filesystem.size() << " digits, " << blocks << "+ blocks" << std::endl;
+  benchmarkBlocks<long long>("long long", filesystem, -1);
+  benchmarkBlocks<Block>("Block    ", filesystem, EMPTY_ENTRY_ID);
+}
+
 int main(int argc, char** argv)
 {
-  auto filesystem = readFilesystem("input.txt");
+  if ((argc == 3) && std::string{argv[1]} == "-b")
+  {
+    benchmarkRepresentations(std::stoull(argv[2]));
+    return 0;
+  }
+
+  if ((argc == 2) && std::string{argv[1]} == "-s")
+  {
+    std::cout << "Checksum(1): " << calculateStreamingChecksum("input.txt") << std::endl;
+    return 0;
+  }
 
-  Filesystem expandedFilesystem = expandFilesystem(filesystem);
-  Filesystem sortedFilesystem = sortFileSystem(expandedFilesystem);
+  auto filesystem = readFilesystem("input.txt");
+  DiskMap diskMap = parseDiskMap(filesystem);
 
-  long long checksum = calculateChecksum(sortedFilesystem);
+  uint64_t checksum = calculateChecksum(compactBlocks(diskMap));
   std::cout << "Checksum(1): " << checksum << std::endl;
 
-  Filesystem sortedFiles = sortFiles(expandedFilesystem);
-  checksum = calculateChecksum(sortedFiles);
+  checksum = calculateChecksum(compactFiles(diskMap));
   std::cout << "Checksum(2): " << checksum << std::endl;
 
   return 0;
-}
\ No newline at end of file
+}